@@ -0,0 +1,380 @@
+/** @file AnalyticSample.cpp
+ *  @brief Implementation of JEMRIS AnalyticSample
+ */
+
+/*
+ *  JEMRIS Copyright (C)
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "AnalyticSample.h"
+#include "XMLIO.h"
+#include "StrX.h"
+
+#include <sstream>
+#include <math.h>
+
+enum ShapeType {ELLIPSOID, CYLINDER};
+
+/**
+ * Modified 3D Shepp-Logan phantom (Kak & Slaney, Toft) on [-1,1]^3:
+ * intensity, semi-axes a b c, center x y z, in-plane rotation [deg]
+ */
+static const double SHEPP_LOGAN[10][8] = {
+	{ 1.0, .6900, .9200, .8100,   0.0,    0.0,   0.0,   0.0},
+	{-0.8, .6624, .8740, .7800,   0.0, -.0184,   0.0,   0.0},
+	{-0.2, .1100, .3100, .2200,   .22,    0.0,   0.0, -18.0},
+	{-0.2, .1600, .4100, .2800,  -.22,    0.0,   0.0,  18.0},
+	{ 0.1, .2100, .2500, .4100,   0.0,    .35,  -.15,   0.0},
+	{ 0.1, .0460, .0460, .0500,   0.0,     .1,   .25,   0.0},
+	{ 0.1, .0460, .0460, .0500,   0.0,    -.1,   .25,   0.0},
+	{ 0.1, .0460, .0230, .0500,  -.08,  -.605,   0.0,   0.0},
+	{ 0.1, .0230, .0230, .0200,   0.0,  -.606,   0.0,   0.0},
+	{ 0.1, .0230, .0460, .0200,   .06,  -.605,   0.0,   0.0}
+};
+
+/**
+ * Default relaxation times of the Shepp-Logan ellipsoids: T1, T2 [ms]
+ */
+static const double SHEPP_LOGAN_TISSUES[10][2] = {
+	{ 250.0,   70.0},
+	{ 900.0,   90.0},
+	{4000.0, 2000.0},
+	{4000.0, 2000.0},
+	{1200.0,  110.0},
+	{1200.0,  110.0},
+	{1200.0,  110.0},
+	{1200.0,  110.0},
+	{1200.0,  110.0},
+	{1200.0,  110.0}
+};
+
+/**********************************************************/
+static bool SheppLoganInside (int j, const double* r) {
+
+	const double* e = SHEPP_LOGAN[j];
+	double cs = cos(e[7]*PI/180.0), sn = sin(e[7]*PI/180.0);
+	double dx = r[0]-e[4], dy = r[1]-e[5], dz = r[2]-e[6];
+	double x  =  cs*dx + sn*dy;
+	double y  = -sn*dx + cs*dy;
+
+	return (x*x/(e[1]*e[1]) + y*y/(e[2]*e[2]) + dz*dz/(e[3]*e[3]) <= 1.0);
+
+}
+
+/**********************************************************/
+static vector<double> ParseVector (const string& str, size_t n, double def) {
+
+	vector<double> v;
+	stringstream   ss (str);
+	double         d;
+
+	while (ss >> d)
+		v.push_back(d);
+
+	v.resize(n, v.empty() ? def : v.back());
+
+	return v;
+
+}
+
+/**********************************************************/
+static string GetAttr (DOMElement* element, const string& key) {
+	return StrX( element->getAttribute( StrX(key).XMLchar()) ).std_str() ;
+}
+
+/**********************************************************/
+static double GetDouble (DOMElement* element, const string& key, double def) {
+	string val = GetAttr (element, key);
+	return val.empty() ? def : atof(val.c_str());
+}
+
+/**********************************************************/
+AnalyticSample::AnalyticSample (const string& fname) {
+
+	Prepare("");
+
+	// no spins: the simulator reports the failure
+	if (Populate(fname) != IO::OK) {
+		cout << "Error in AnalyticSample::AnalyticSample() - could not read " << fname << endl;
+		return;
+	}
+
+	CropEnumerate();
+
+}
+
+/**********************************************************/
+int AnalyticSample::TissueIndex (const string& name) {
+
+	for (size_t i = 0; i < m_tissues.size(); i++)
+		if (m_tissues[i].name == name)
+			return i;
+
+	return -1;
+
+}
+
+/**********************************************************/
+void AnalyticSample::AddSheppLogan (double size, const vector<string>& tissues) {
+
+	for (int i = 0; i < 10; i++) {
+
+		stringstream sn;
+		sn << "SL" << i+1;
+		string name = (i < (int) tissues.size()) ? tissues[i] : sn.str();
+
+		int t = TissueIndex (name);
+
+		if (t < 0) {
+			// M0: the intensities of all ellipsoids up to this one, which cover its center
+			double M0 = 0.0;
+			for (int j = 0; j <= i; j++)
+				if (SheppLoganInside (j, &SHEPP_LOGAN[i][4]))
+					M0 += SHEPP_LOGAN[j][0];
+			Tissue tissue;
+			tissue.name = name;
+			tissue.M0   = (M0 > 1e-9) ? M0 : 0.0;
+			tissue.R1   = 1.0/SHEPP_LOGAN_TISSUES[i][0];
+			tissue.R2   = 1.0/SHEPP_LOGAN_TISSUES[i][1];
+			tissue.R2S  = tissue.R2;
+			tissue.DB   = 0.0;
+			m_tissues.push_back(tissue);
+			t = m_tissues.size() - 1;
+		}
+
+		Shape s;
+		s.type   = ELLIPSOID;
+		s.tissue = t;
+		s.axis   = ZC;
+		for (int j = 0; j < 3; j++) {
+			s.a[j] = 0.5 * size * SHEPP_LOGAN[i][1+j];
+			s.c[j] = 0.5 * size * SHEPP_LOGAN[i][4+j];
+		}
+		s.cs = cos(SHEPP_LOGAN[i][7]*PI/180.0);
+		s.sn = sin(SHEPP_LOGAN[i][7]*PI/180.0);
+		m_shapes.push_back(s);
+
+	}
+
+}
+
+/**********************************************************/
+IO::Status AnalyticSample::Populate (const string& fname) {
+
+	m_index.resize(3);
+
+	XMLIO        xio;
+	DOMDocument* doc = xio.Parse(fname);
+
+	if (doc == NULL)
+		return IO::FILE_NOT_FOUND;
+
+	DOMElement* root = doc->getDocumentElement();
+
+	if (root == NULL || StrX(root->getNodeName()).std_str() != "AnalyticSample") {
+		cout << "Error in AnalyticSample::Populate() - " << fname << " is not an AnalyticSample" << endl;
+		return IO::FILE_NOT_FOUND;
+	}
+
+	vector<double> dims = ParseVector (GetAttr(root, "Dimensions"), 3, 1.0);
+	m_res               = ParseVector (GetAttr(root, "Resolution"), 3, 1.0);
+	m_offset            = ParseVector (GetAttr(root, "Offset"),     3, 0.0);
+
+	for (int i = 0; i < 3; i++)
+		m_index[i] = (dims[i] < 1.0) ? 1 : (size_t) dims[i];
+
+	m_tissues.clear();
+	m_shapes.clear();
+
+	for (DOMNode* node = root->getFirstChild(); node != 0; node = node->getNextSibling()) {
+
+		if (node->getNodeType() != DOMNode::ELEMENT_NODE)
+			continue;
+
+		DOMElement* el   = (DOMElement*) node;
+		string      name = StrX(el->getNodeName()).std_str();
+
+		if (name == "Tissue") {
+
+			Tissue t;
+			t.name   = GetAttr  (el, "Name");
+			t.M0     = GetDouble(el, "M0", 1.0);
+			double T1  = GetDouble(el, "T1",  0.0);
+			double T2  = GetDouble(el, "T2",  0.0);
+			double T2S = GetDouble(el, "T2S", T2);
+			t.R1     = (T1  > 0.0) ? 1.0/T1  : 0.0;
+			t.R2     = (T2  > 0.0) ? 1.0/T2  : 0.0;
+			t.R2S    = (T2S > 0.0) ? 1.0/T2S : 0.0;
+			t.DB     = GetDouble(el, "DB", 0.0);
+			m_tissues.push_back(t);
+
+		} else if (name == "Ellipsoid" || name == "Cylinder") {
+
+			Shape s;
+			s.tissue = TissueIndex (GetAttr(el, "Tissue"));
+
+			if (s.tissue < 0) {
+				cout << "Error in AnalyticSample::Populate() - unknown tissue '"
+				     << GetAttr(el, "Tissue") << "'" << endl;
+				return IO::UNMATCHED_DIMENSIONS;
+			}
+
+			vector<double> c = ParseVector (GetAttr(el, "Center"), 3, 0.0);
+			vector<double> a;
+
+			if (name == "Ellipsoid") {
+				s.type = ELLIPSOID;
+				s.axis = ZC;
+				a      = ParseVector (GetAttr(el, "Axes"), 3, 1.0);
+			} else {
+				s.type = CYLINDER;
+				string axis = GetAttr(el, "Axis");
+				s.axis = (axis == "x" || axis == "X") ? XC : ((axis == "y" || axis == "Y") ? YC : ZC);
+				a.resize(3);
+				a[0] = a[1] = GetDouble(el, "Radius", 1.0);
+				a[2] = 0.5 * GetDouble(el, "Length", 1.0);
+			}
+
+			for (int j = 0; j < 3; j++) {
+				s.c[j] = c[j];
+				s.a[j] = a[j];
+			}
+
+			double angle = GetDouble(el, "Angle", 0.0);
+			s.cs = cos(angle*PI/180.0);
+			s.sn = sin(angle*PI/180.0);
+			m_shapes.push_back(s);
+
+		} else if (name == "SheppLogan") {
+
+			vector<string> tissues;
+			stringstream   ss (GetAttr(el, "Tissues"));
+			string         t;
+
+			while (ss >> t)
+				tissues.push_back(t);
+
+			AddSheppLogan (GetDouble(el, "Size", 200.0), tissues);
+
+		}
+
+	}
+
+	return IO::OK;
+
+}
+
+/**********************************************************/
+int AnalyticSample::Paint (const double* r) const {
+
+	int tissue = -1;
+
+	for (size_t i = 0; i < m_shapes.size(); i++) {
+
+		const Shape& s = m_shapes[i];
+
+		double d[3] = {r[XC]-s.c[XC], r[YC]-s.c[YC], r[ZC]-s.c[ZC]};
+
+		if (s.type == ELLIPSOID) {
+
+			// rotate into the ellipsoid frame (in-plane rotation)
+			double x =  s.cs*d[XC] + s.sn*d[YC];
+			double y = -s.sn*d[XC] + s.cs*d[YC];
+			double z =  d[ZC];
+
+			if (x*x/(s.a[0]*s.a[0]) + y*y/(s.a[1]*s.a[1]) + z*z/(s.a[2]*s.a[2]) <= 1.0)
+				tissue = s.tissue;
+
+		} else {
+
+			// axial and radial distance to the cylinder axis
+			double h  = d[s.axis];
+			double r2 = d[XC]*d[XC] + d[YC]*d[YC] + d[ZC]*d[ZC] - h*h;
+
+			if (fabs(h) <= s.a[2] && r2 <= s.a[0]*s.a[0])
+				tissue = s.tissue;
+
+		}
+
+	}
+
+	return tissue;
+
+}
+
+/**********************************************************/
+void AnalyticSample::CropEnumerate () {
+
+	m_voxels.clear();
+	m_class.clear();
+
+	size_t n = 0;
+	double r[3];
+
+	for (size_t nz = 0; nz < m_index[ZC]; nz++)
+		for (size_t ny = 0; ny < m_index[YC]; ny++)
+			for (size_t nx = 0; nx < m_index[XC]; nx++, n++) {
+
+				r[XC] = (nx-0.5*(m_index[XC]-1))*m_res[XC]+m_offset[XC];
+				r[YC] = (ny-0.5*(m_index[YC]-1))*m_res[YC]+m_offset[YC];
+				r[ZC] = (nz-0.5*(m_index[ZC]-1))*m_res[ZC]+m_offset[ZC];
+
+				int t = Paint (r);
+
+				if (t >= 0 && m_tissues[t].M0 > 0) {
+					m_voxels.push_back(n);
+					m_class.push_back(t);
+				}
+
+			}
+
+	// Only dimensions and spin count; the ensemble holds no data
+	m_ensemble.Clear();
+	m_ensemble.m_dims.push_back(NO_SPIN_PROPERTIES);
+	m_ensemble.m_dims.insert(m_ensemble.m_dims.end(), m_index.begin(), m_index.end());
+	m_ensemble.m_nspins = m_voxels.size();
+
+	m_spin_state.clear();
+	m_spin_state.resize(GetSize(),0);
+
+}
+
+/**********************************************************/
+void AnalyticSample::CopyVoxel (const size_t n, double* val) {
+
+	size_t v  = m_voxels[n];
+	size_t nx = v % m_index[XC];
+	size_t ny = (v / m_index[XC]) % m_index[YC];
+	size_t nz = v / (m_index[XC]*m_index[YC]);
+
+	const Tissue& t = m_tissues[m_class[n]];
+
+	val[XC]  = (nx-0.5*(m_index[XC]-1))*m_res[XC]+m_offset[XC];
+	val[YC]  = (ny-0.5*(m_index[YC]-1))*m_res[YC]+m_offset[YC];
+	val[ZC]  = (nz-0.5*(m_index[ZC]-1))*m_res[ZC]+m_offset[ZC];
+	val[M0]  = t.M0;
+	val[R1]  = t.R1;
+	val[R2]  = t.R2;
+	val[R2S] = t.R2S;
+	val[DB]  = t.DB;
+	val[ID]  = n;
+
+}
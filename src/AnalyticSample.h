@@ -0,0 +1,153 @@
+/** @file AnalyticSample.h
+ *  @brief Implementation of JEMRIS AnalyticSample
+ */
+
+/*
+ *  JEMRIS Copyright (C)
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ANALYTIC_SAMPLE_H_
+#define ANALYTIC_SAMPLE_H_
+
+#include "Sample.h"
+
+/**
+ * @brief Tissue class of an analytic sample
+ */
+struct Tissue {
+	string name;    /**< Name referenced by the shapes       */
+	double M0;      /**< Equilibrium magnetisation           */
+	double R1;      /**< 1/T1 [1/ms]                         */
+	double R2;      /**< 1/T2 [1/ms]                         */
+	double R2S;     /**< 1/T2* [1/ms]                        */
+	double DB;      /**< Off-resonance [rad/s]               */
+};
+
+/**
+ * @brief Geometric primitive of an analytic sample
+ */
+struct Shape {
+	int    type;    /**< ELLIPSOID or CYLINDER               */
+	int    tissue;  /**< Index into the tissue table         */
+	int    axis;    /**< Cylinder axis (XC, YC or ZC)        */
+	double c[3];    /**< Center [mm]                         */
+	double a[3];    /**< Semi-axes, or radius/half length [mm] */
+	double cs;      /**< Cosine of in-plane rotation         */
+	double sn;      /**< Sine of in-plane rotation           */
+};
+
+/**
+ * @brief Procedurally generated sample
+ *
+ * The sample is described by a small XML file of tissue classes and
+ * geometric primitives, e.g.
+ *
+ * @code
+ * <AnalyticSample Dimensions="128 128 1" Resolution="1.5 1.5 1" Offset="0 0 0">
+ *   <Tissue    Name="WM" M0="0.77" T1="500" T2="70" T2S="60" DB="0"/>
+ *   <Ellipsoid Tissue="WM" Center="0 0 0" Axes="80 60 10" Angle="0"/>
+ *   <Cylinder  Tissue="WM" Center="0 0 0" Radius="10" Length="20" Axis="z"/>
+ *   <SheppLogan Size="180"/>
+ * </AnalyticSample>
+ * @endcode
+ *
+ * Shapes are painted in document order; later shapes overwrite earlier ones.
+ * SheppLogan expands to the ten ellipsoids of the modified 3D Shepp-Logan phantom,
+ * painted with the tissue classes SL1 ... SL10 (or the names given in Tissues).
+ *
+ * Only an index of the live voxels is kept. Spin properties are generated on
+ * request, so MPI slaves can generate their own spin range without receiving
+ * any sample data.
+ */
+class AnalyticSample : public Sample {
+
+ public:
+
+	/**
+	 * @brief Constructor
+	 */
+	AnalyticSample () {};
+
+	/**
+	 * @brief Create a sample from XML description
+	 *
+	 * @param fname XML file
+	 */
+	AnalyticSample (const string& fname);
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~AnalyticSample () {};
+
+	/**
+	 * @brief Parse the XML description
+	 *
+	 * @param fname XML file
+	 * @return      Status
+	 */
+	virtual IO::Status Populate (const string& fname);
+
+	/**
+	 * @brief Paint the shapes onto the grid and keep an index of the live voxels
+	 */
+	virtual void CropEnumerate ();
+
+	/**
+	 * @brief Spin properties are generated, not stored
+	 */
+	virtual bool IsProcedural () const {return true;};
+
+ protected:
+
+	/**
+	 * @brief Generate the properties of the n-th live voxel
+	 *
+	 * @param n   Voxel number
+	 * @param val Output container
+	 */
+	virtual void CopyVoxel (const size_t n, double* val);
+
+ private:
+
+	/**
+	 * @brief Tissue index painted at a position (-1 if none)
+	 */
+	int  Paint (const double* r) const;
+
+	/**
+	 * @brief Add the ellipsoids of the modified Shepp-Logan phantom
+	 */
+	void AddSheppLogan (double size, const vector<string>& tissues);
+
+	/**
+	 * @brief Index of a tissue by name
+	 */
+	int  TissueIndex (const string& name);
+
+	vector<Tissue>   m_tissues;  /**< Tissue lookup table             */
+	vector<Shape>    m_shapes;   /**< Shapes in painting order        */
+	vector<size_t>   m_voxels;   /**< Grid index of each live voxel   */
+	vector<int>      m_class;    /**< Tissue of each live voxel       */
+
+};
+
+#endif /*ANALYTIC_SAMPLE_H_*/
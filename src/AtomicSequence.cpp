@@ -106,11 +106,7 @@ inline void      AtomicSequence::GetValue (double * dAllVal, double const time)
     		 ((RFPulse*) children[j])->GetCoilArray()!=NULL 		&&	// 2.) it has a coil array
     		 ((RFPulse*) children[j])->GetCoilArray()->GetSize()>1  &&	// 3.) the array has multiple coils
     		 !children[j]->HasDOMattribute("Channel") ) {				// 4.) the RF pulse has no channel explicitly specified
-    		for (unsigned k=0; k<((RFPulse*) children[j])->GetCoilArray()->GetSize(); k++) {
-    			((RFPulse*) children[j])->SetChannel(k);
-    			children[j]->GetValue(dAllVal,pulse_time);
-    		}
-    		((RFPulse*) children[j])->SetChannel(0);
+    		((RFPulse*) children[j])->GetValueAllChannels(dAllVal,pulse_time);
     		continue;
     	}
 
@@ -234,6 +230,10 @@ void AtomicSequence::CollectSeqData(NDData<double>& seqdata, double& t, long& of
 		//cout << GetName() << " " << setw(9) << setfill(' ') << m_tpoi.GetTime(i)+t << setw(9) << setfill(' ') << " " << seqdata(5,offset+i+1) << endl;
 		if (pW->pStaticAtom != NULL) pW->pStaticAtom->GetValue( &seqdata(2,offset+i+1), m_tpoi.GetTime(i) + t );
         GetValueLingeringEddyCurrents(&seqdata(2,offset+i+1), m_tpoi.GetTime(i));
+		// sequence diagrams show the RF field in polar form
+		double B1x = seqdata(2+RF_X,offset+i+1), B1y = seqdata(2+RF_Y,offset+i+1);
+		seqdata(2+RF_X,offset+i+1) = sqrt(B1x*B1x + B1y*B1y);
+		seqdata(2+RF_Y,offset+i+1) = atan2(B1y,B1x);
 		seqdata(MAX_SEQ_VAL+1+2,offset+i+1) = m_tpoi.GetMask(i);
 
 		if (seqdata.Dim(0) > MAX_SEQ_VAL+1+3){
@@ -81,6 +81,18 @@ public:
 	Read (NDData<T>& data, const char* urn, const char* url = "") {
 		return Read (data, std::string(urn), std::string(url));
 	}
+
+	/**
+	 * @brief        Read consecutive entries of the slowest varying dimension (HDF5 only)
+	 *
+	 * @see          HDF5IO::ReadSlab
+	 */
+	template<class T> IO::Status
+	ReadSlab (NDData<T>& data, const std::string& urn, const std::string& url, const size_t first, size_t& count, size_t& total) {
+		if (m_strategy->IOStrategy() == IO::HDF5)
+			return ((HDF5IO*)m_strategy)->ReadSlab(data, urn, url, first, count, total);
+		return IO::FILE_NOT_FOUND;
+	}
 	/**
 	 * @brief        Get last status
 	 *
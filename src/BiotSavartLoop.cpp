@@ -52,13 +52,29 @@ bool BiotSavartLoop::Prepare (const PrepareMode mode) {
 double BiotSavartLoop::GetSensitivity(const double* position) {
 
 #ifndef HAVE_BOOST
-	m_biosavart_phase = 0.0;
 	if (m_first_call) cout << "Warning! BiotSavartLoop misses BOOST library. Returns uniform sensitivity.\n";
 	m_first_call = false;
+#endif
+
+	return B1(position, m_biosavart_phase);
+
+}
+
+void BiotSavartLoop::MapPoint (const double* position, double& magnitude, double& phase) {
+
+	magnitude = B1(position, phase);
+
+}
+
+double BiotSavartLoop::B1 (const double* position, double& phase) const {
+
+#ifndef HAVE_BOOST
+	phase = 0.0;
 	return 1.0;
 #endif
 
     double a     = m_radius;
+    phase        = 0.0;
     double px = position[XC]-m_position[XC];
     double py = position[YC]-m_position[YC];
     double pz = position[ZC]-m_position[ZC];
@@ -153,8 +169,8 @@ double BiotSavartLoop::GetSensitivity(const double* position) {
     // compute |B1|
     double B1 = sqrt(pow(Bx,2.0)+pow(By,2.0));
 
-    // compute phase and store for later retrieval 
-    m_biosavart_phase = atan2(By,Bx); 
+    // compute phase (stored by GetSensitivity for later retrieval)
+    phase = atan2(By,Bx); 
     
     // check for numerical problems
     B1 = (isnan(B1)? 0.5:B1);
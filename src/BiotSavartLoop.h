@@ -63,6 +63,20 @@ class BiotSavartLoop : public Coil {
 	 */
 	inline double GetPhase (const double* position) {return this->m_biosavart_phase;};
 
+	/**
+	 * @brief  Magnitude and phase at given position (reentrant)
+	 *
+	 * @param  position  Position.
+	 * @param  magnitude Sensitivity at requested position.
+	 * @param  phase     Phase at requested position.
+	 */
+	virtual void MapPoint (const double* position, double& magnitude, double& phase);
+
+	/**
+	 * @brief  Maps are computed in parallel
+	 */
+	virtual bool ParallelMap () const {return true;};
+
 	/**
 	 * @brief Clone.
 	 *
@@ -78,9 +92,14 @@ class BiotSavartLoop : public Coil {
      */
     virtual bool Prepare (const PrepareMode mode);
 
-
  private:
 
+    /**
+     * @brief  B1+ magnitude and phase of the loop
+     */
+    double B1 (const double* position, double& phase) const;
+
+
     double            m_mask;               /**< Torus radius to mask field on the wire */
     double            m_radius;             /**< Loop radius */
     double            m_biosavart_phase;    /**< @brief Phase */
@@ -26,6 +26,7 @@
 
 #include "Bloch_CV_Model.h"
 #include "DynamicVariables.h"
+#include "TrajectoryLog.h"
 //MODIF
 #include <iostream>
 #include <fstream>
@@ -58,49 +59,29 @@ inline static int bloch (realtype rt, N_Vector y, N_Vector ydot, void *pWorld) {
     double r2 = pW->Values[R2];
     double m0 = pW->Values[M0];
     double position[3];
-    position[0] = pW->Values[XC];position[1]=pW->Values[YC];position[2]=pW->Values[ZC];
     double DeltaB = pW->deltaB;
 
     // update sample variables if they are dynamic:
-    dv->m_Diffusion->GetValue(time, position);
+    if (pW->logFile || pW->logTrajectories) {
+        // logging of the intermediate flow positions: evaluate step by step
+        position[0] = pW->Values[XC];position[1]=pW->Values[YC];position[2]=pW->Values[ZC];
+        dv->m_Diffusion->GetValue(time, position);
 //MODIF
-    if(pW->logFile)
-    {
-        //cout<<"Spin number: "<<pW->SpinNumber<<endl;
-        if((pW->SpinNumber==0) && (time==0))  {
-            fstream log0("FLOW.log",ios::out|ios::trunc);
-            log0.close();
-            }
-        fstream log1("FLOW.log",ios::out|ios::app);
-        log1<<"t "<<time<<"  "<<"spin"<<pW->SpinNumber<<" position: "<<position[0]<<" "<<position[1]<<" "<<position[2]<<" Activation: "<<dv->m_Flow->spinActivation(pW->SpinNumber)<<endl;
-        log1.close();
-    }
-    long trajNumber=pW->getTrajBegin()+pW->SpinNumber;
-    dv->m_Flow->GetValue(time, position, trajNumber);
-    if(pW->logFile)
-    {
-        fstream log2("FLOW.log",ios::out|ios::app);
-        log2<<"t "<<time<<"  "<<"spin"<<pW->SpinNumber<<" position: "<<position[0]<<" "<<position[1]<<" "<<position[2]<<" Activation: "<<dv->m_Flow->spinActivation(pW->SpinNumber)<<endl<<endl;
-        log2.close();
-    }
-    if(pW->logTrajectories)
-    {
-        if((pW->SpinNumber==0) && (time==0))  {
-            fstream logTraj0("trajectories.log",ios::out|ios::trunc);
-            logTraj0.close();
-            }
-        if(dv->m_Flow->spinActivation(pW->SpinNumber))  {
-            fstream logTraj("trajectories.log",ios::out|ios::app);
-            if(time==0)  logTraj<<endl;
-            logTraj<<pW->SpinNumber<<" "<<time<<" "<<position[0]<<" "<<position[1]<<" "<<position[2]<<endl;
-            logTraj.close();
-            }
-    }
+        long trajNumber=pW->getTrajBegin()+pW->SpinNumber;
+        // the log (file and writer thread) is only created once there is something to record
+        if(pW->logFile)
+            TrajectoryLog::instance()->Record(LOG_POSITION, time, trajNumber, position, dv->m_Flow->spinActivation(pW->SpinNumber));
+        dv->m_Flow->GetValue(time, position, trajNumber);
+        bool active = dv->m_Flow->spinActivation(pW->SpinNumber);
+        if(pW->logFile || (pW->logTrajectories && active))
+            TrajectoryLog::instance()->Record(LOG_FLOW, time, trajNumber, position, active);
 //MODIF***
 //Mod
-    dv->m_Respiration->GetValue(time, position);
+        dv->m_Respiration->GetValue(time, position);
 //
-    dv->m_Motion->GetValue(time, position);
+        dv->m_Motion->GetValue(time, position);
+    } else
+        pW->SpinPosition(time, position);
     dv->m_T2prime->GetValue(time, &DeltaB);
     dv->m_R1->GetValue(time, &r1);
     dv->m_R2->GetValue(time, &r2);
@@ -117,7 +98,7 @@ inline static int bloch (realtype rt, N_Vector y, N_Vector ydot, void *pWorld) {
 //MODIF***
 
     //get current B-field values from the sequence
-    double  d_SeqVal[5]={0.0,0.0,0.0,0.0,0.0};									// [B1magn,B1phase,Gx,Gy,Gz]
+    double  d_SeqVal[5]={0.0,0.0,0.0,0.0,0.0};									// [B1x,B1y,Gx,Gy,Gz]
     pW->pAtom->GetValue( d_SeqVal, t );        								    // calculates also pW->NonLinGradField
     if (pW->pStaticAtom != NULL) pW->pStaticAtom->GetValue( d_SeqVal, time );	// calculates static offsets
     pW->pAtom->GetValueLingeringEddyCurrents(d_SeqVal,t);					    // calculates lingering eddy currents
@@ -125,8 +106,8 @@ inline static int bloch (realtype rt, N_Vector y, N_Vector ydot, void *pWorld) {
     double Bx, By, Bz;
 
     //Transverse Components: RF field
-    Bx = d_SeqVal[RF_AMP]*cos(d_SeqVal[RF_PHS]);
-    By = d_SeqVal[RF_AMP]*sin(d_SeqVal[RF_PHS]);
+    Bx = d_SeqVal[RF_X];
+    By = d_SeqVal[RF_Y];
 
     //Longitudinal component: Gradient field and off-resonance contributions
     Bz = position[0]*d_SeqVal[GRAD_X]+ position[1]*d_SeqVal[GRAD_Y]+ position[2]*d_SeqVal[GRAD_Z]
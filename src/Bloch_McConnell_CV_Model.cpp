@@ -133,15 +133,15 @@ static int bloch (realtype t, N_Vector y, N_Vector ydot, void *pWorld) {
     }
 
     //get current B-field values from the sequence
-    double  d_SeqVal[5] = {0.0,0.0,0.0,0.0,0.0};                           // [B1magn,B1phase,Gx,Gy,Gz]
+    double  d_SeqVal[5] = {0.0,0.0,0.0,0.0,0.0};                           // [B1x,B1y,Gx,Gy,Gz]
     pW->pAtom->GetValue( d_SeqVal, t );                                    // calculates also pW->NonLinGradField
     if (pW->pStaticAtom != NULL) pW->pStaticAtom->GetValue( d_SeqVal, t ); // calculates also pW->NonLinGradField
     double Bx=0.0, By=0.0, Bz=0.0;
     double* BzPool = new double[ncomp];
 
     //RF field
-    Bx = d_SeqVal[RF_AMP]*cos(d_SeqVal[RF_PHS]);
-    By = d_SeqVal[RF_AMP]*sin(d_SeqVal[RF_PHS]);
+    Bx = d_SeqVal[RF_X];
+    By = d_SeqVal[RF_Y];
 
 
     //Gradient field
@@ -186,7 +186,7 @@ static int bloch (realtype t, N_Vector y, N_Vector ydot, void *pWorld) {
     		NV_Ith_S(ydot,ZC+i) = 0.0;
 
 			
-    	} else if ((Mx[pool]*Mx[pool] + My[pool]*My[pool]) < ATOL1 * m0 && d_SeqVal[RF_AMP]==0.0) {
+    	} else if ((Mx[pool]*Mx[pool] + My[pool]*My[pool]) < ATOL1 * m0 && d_SeqVal[RF_X]==0.0 && d_SeqVal[RF_Y]==0.0) {
         	//trivial case: no transv. magnetization AND no excitation
     		NV_Ith_S(y,   XC+i) = 0.0;
     		NV_Ith_S(y,   YC+i) = 0.0;
@@ -0,0 +1,233 @@
+/** @file Checkpoint.cpp
+ *  @brief Implementation of JEMRIS Checkpoint
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "Checkpoint.h"
+#include "CoilArray.h"
+#include "Coil.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+static const long CHECKPOINT_MAGIC = 0x4a454d52; // "JEMR"
+
+/***********************************************************/
+Checkpoint::Checkpoint () {
+
+	m_pending = false;
+	m_stop    = false;
+	m_ncoils  = 0;
+	m_samples = 0;
+	m_nprops  = 0;
+
+	// continue the numbering of a previous run, which may have left a newer file
+	m_seq     = 0;
+	for (int i = 0; i < 2; i++) {
+		long head[2] = {0, 0};
+		ifstream fin (FileName(i).c_str(), ios::binary);
+		if (fin.read((char*) head, sizeof(head)) && head[0] == CHECKPOINT_MAGIC && head[1] > m_seq)
+			m_seq = head[1];
+	}
+
+	m_thread  = std::thread(&Checkpoint::Run, this);
+
+}
+
+/***********************************************************/
+Checkpoint::~Checkpoint () {
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_one();
+	m_thread.join();
+
+}
+
+/***********************************************************/
+string Checkpoint::FileName (int i) {
+
+	return (i == 0) ? ".restart0.dat" : ".restart1.dat";
+
+}
+
+/***********************************************************/
+bool Checkpoint::Save (CoilArray* RxCA, const vector<char>& state) {
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pending)
+			return false;
+	}
+
+	// the I/O thread is idle: the snapshot buffers are ours
+	Repository* r = RxCA->GetCoil(0)->GetSignal()->Repo();
+	m_ncoils  = RxCA->GetSize();
+	m_samples = r->Samples();
+	m_nprops  = r->NProps();
+	m_times.resize(m_ncoils * m_samples);
+	m_data.resize (m_ncoils * m_samples * m_nprops);
+
+	for (int c = 0; c < m_ncoils; c++) {
+		r = RxCA->GetCoil(c)->GetSignal()->Repo();
+		memcpy (&m_times[c*m_samples], r->Times(), m_samples * sizeof(double));
+		double* d = &m_data[c*m_samples*m_nprops];
+		if (r->Compact())
+			for (long i = 0; i < r->Size(); i++)
+				d[i] = r->Value(i);
+		else
+			memcpy (d, r->Data(), r->Size() * sizeof(double));
+	}
+	m_state = state;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_seq++;
+		m_pending = true;
+	}
+	m_cond.notify_one();
+
+	return true;
+
+}
+
+/***********************************************************/
+void Checkpoint::Run () {
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+
+		m_cond.wait(lock, [this] {return m_pending || m_stop;});
+
+		if (m_pending) {
+			lock.unlock();
+			Write();
+			lock.lock();
+			m_pending = false;
+		}
+
+		if (m_stop)
+			return;
+
+	}
+
+}
+
+/***********************************************************/
+void Checkpoint::Write () {
+
+	// overwrite the older file; the newer one stays valid until this one is complete
+	ofstream fout (FileName(m_seq % 2).c_str(), ios::binary | ios::trunc);
+
+	long head[6] = {CHECKPOINT_MAGIC, m_seq, (long) m_ncoils, m_samples, (long) m_nprops, (long) m_state.size()};
+
+	fout.write ((char*) head, sizeof(head));
+	fout.write ((char*) &m_times[0], m_times.size() * sizeof(double));
+	fout.write ((char*) &m_data[0],  m_data.size()  * sizeof(double));
+	fout.write (&m_state[0], m_state.size());
+	fout.write ((char*) &m_seq, sizeof(long));
+	fout.close();
+
+}
+
+/***********************************************************/
+int Checkpoint::Load (CoilArray* RxCA, vector<char>& state) {
+
+	int  ncoils  = RxCA->GetSize();
+	Repository* r = RxCA->GetCoil(0)->GetSignal()->Repo();
+	long samples = r->Samples();
+	long nprops  = r->NProps();
+	long size    = sizeof(long) * 7 + ncoils * samples * (nprops + 1) * sizeof(double) + state.size();
+
+	// latest complete checkpoint
+	int  best  = -1;
+	long bseq  = 0;
+	bool found = false;
+	for (int i = 0; i < 2; i++) {
+
+		ifstream fin (FileName(i).c_str(), ios::binary);
+		if (!fin.is_open())
+			continue;
+		found = true;
+
+		long head[6], tail = -1;
+		fin.seekg (0, ios::end);
+		long length = fin.tellg();
+		fin.seekg (0, ios::beg);
+		fin.read  ((char*) head, sizeof(head));
+		if (!fin || head[0] != CHECKPOINT_MAGIC || head[2] != ncoils || head[3] != samples ||
+		    head[4] != nprops || head[5] != (long) state.size() || length != size)
+			continue;
+		fin.seekg (-((long) sizeof(long)), ios::end);
+		fin.read  ((char*) &tail, sizeof(long));
+		if (tail != head[1] || head[1] <= bseq)
+			continue;
+
+		best = i;
+		bseq = head[1];
+
+	}
+
+	if (!found)  return -2;
+	if (best < 0) return -1;
+
+	ifstream fin (FileName(best).c_str(), ios::binary);
+	fin.seekg (sizeof(long) * 6, ios::beg);
+
+	for (int c = 0; c < ncoils; c++) {
+		r = RxCA->GetCoil(c)->GetSignal()->Repo();
+		fin.read ((char*) r->Times(), samples * sizeof(double));
+	}
+	vector<double> buf (samples * nprops);
+	for (int c = 0; c < ncoils; c++) {
+		r = RxCA->GetCoil(c)->GetSignal()->Repo();
+		fin.read ((char*) &buf[0], buf.size() * sizeof(double));
+		for (long i = 0; i < r->Size(); i++)
+			r->Set (i, buf[i]);
+	}
+	fin.read (&state[0], state.size());
+
+	return 0;
+
+}
+
+/***********************************************************/
+void Checkpoint::Remove () {
+
+	for (int i = 0; i < 2; i++)
+		remove (FileName(i).c_str());
+
+}
+
+/***********************************************************/
+void Checkpoint::Backup () {
+
+	rename (FileName(0).c_str(), "restart0.bak");
+	rename (FileName(1).c_str(), "restart1.bak");
+
+}
@@ -0,0 +1,127 @@
+/** @file Checkpoint.h
+ *  @brief Implementation of JEMRIS Checkpoint
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+class CoilArray;
+
+/**
+ * @brief Restart checkpoints, written by a background thread
+ *
+ * Save copies the signals of all coils and the spin states into a snapshot
+ * buffer and returns; the snapshot is written by the I/O thread. While a
+ * snapshot is still being written, further checkpoints are skipped, so the
+ * simulation never waits for the disk.
+ *
+ * Checkpoints alternate between two files. Each file ends with the sequence
+ * number of its header; a file cut short by a crash is not valid, and the
+ * other file still holds the previous checkpoint.
+ */
+class Checkpoint {
+
+ public:
+
+	/**
+	 * @brief Constructor, starts the I/O thread
+	 */
+	Checkpoint ();
+
+	/**
+	 * @brief Destructor, finishes a pending write and stops the I/O thread
+	 */
+	~Checkpoint ();
+
+	/**
+	 * @brief Take a snapshot and have it written in the background
+	 *
+	 * @param RxCA   Receive coil array
+	 * @param state  Spin states (0: not touched, 1: sent, 2: calculated)
+	 * @return       False, if the previous snapshot is still being written
+	 */
+	bool        Save    (CoilArray* RxCA, const vector<char>& state);
+
+	/**
+	 * @brief Read the latest valid checkpoint
+	 *
+	 * @param RxCA   Receive coil array, its signals are overwritten
+	 * @param state  Spin states
+	 * @return       0: success, -1: checkpoint does not fit, -2: no checkpoint
+	 */
+	static int  Load    (CoilArray* RxCA, vector<char>& state);
+
+	/**
+	 * @brief Delete the checkpoint files
+	 */
+	static void Remove  ();
+
+	/**
+	 * @brief Keep checkpoint files which do not fit as backup
+	 */
+	static void Backup  ();
+
+ private:
+
+	/**
+	 * @brief I/O thread
+	 */
+	void        Run     ();
+
+	/**
+	 * @brief Write the snapshot
+	 */
+	void        Write   ();
+
+	/**
+	 * @brief Name of one of the two checkpoint files
+	 */
+	static string FileName (int i);
+
+	std::thread             m_thread;   /**< I/O thread                         */
+	std::mutex              m_mutex;    /**< Guards m_pending and m_stop        */
+	std::condition_variable m_cond;     /**< Wakes the I/O thread               */
+	bool                    m_pending;  /**< Snapshot waiting to be written     */
+	bool                    m_stop;     /**< Stop the I/O thread                */
+	long                    m_seq;      /**< Number of the snapshot             */
+
+	int                     m_ncoils;   /**< Number of coils                    */
+	long                    m_samples;  /**< Samples per coil                   */
+	int                     m_nprops;   /**< Values per sample                  */
+	vector<double>          m_times;    /**< Time points of all coils           */
+	vector<double>          m_data;     /**< Signals of all coils               */
+	vector<char>            m_state;    /**< Spin states                        */
+
+};
+
+#endif /*CHECKPOINT_H_*/
@@ -27,6 +27,12 @@
 #include "Coil.h"
 #include "Model.h"
 #include "DynamicVariables.h"
+#include "BinaryContext.h"
+
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
 
 /**********************************************************/
 Coil::~Coil() {
@@ -51,12 +57,12 @@ void Coil::Initialize (DOMNode* node) {
 }
 
 /**********************************************************/
-void Coil::InitSignal(long lADCs) {
+void Coil::InitSignal(long lADCs, bool compact) {
 	
     if (m_signal!=NULL)
         delete m_signal;
 	
-    m_signal = new Signal (lADCs, World::instance()->GetNoOfCompartments());
+    m_signal = new Signal (lADCs, World::instance()->GetNoOfCompartments(), compact);
 	
 }
 
@@ -66,50 +72,206 @@ void Coil::Receive (long lADC) {
 	World* pW = World::instance();
     m_signal->Repo()->TP(lADC) = pW->time;
 	
-    double sens  = GetSensitivity (m_signal->Repo()->TP(lADC));
-    double phase = GetPhase       (m_signal->Repo()->TP(lADC));
+    double sens, phase;
+    GetB1 (m_signal->Repo()->TP(lADC), sens, phase);
 	
-	long   pos   = m_signal->Repo()->Position(lADC); 
+	Repository* repo = m_signal->Repo();
+	long   pos   = repo->Position(lADC); 
+	int    n     = repo->Stride();
 	
 	double tm    = 0.0;
 
-	for (int i = 0; i < m_signal->Repo()->Compartments(); i++) {
+	for (int i = 0; i < repo->Compartments(); i++) {
 
 		tm = - pW->phase + phase + World::instance()->solution[PHASE+ i*3];
 
-		m_signal->Repo()->at(pos +     i*3) += sens  * pW->solution[i*3 + AMPL] * cos (tm);
-		m_signal->Repo()->at(pos + 1 + i*3) += sens  * pW->solution[i*3 + AMPL] * sin (tm);
-		m_signal->Repo()->at(pos + 2 + i*3) += sens  * pW->solution[i*3 + 2];
+		repo->Add (pos +     i*n, sens  * pW->solution[i*3 + AMPL] * cos (tm));
+		repo->Add (pos + 1 + i*n, sens  * pW->solution[i*3 + AMPL] * sin (tm));
+		if (n == 3)
+			repo->Add (pos + 2 + i*n, sens  * pW->solution[i*3 + 2]);
 
 	}
 }
 
 /**********************************************************/
-void Coil::GridMap () {
+void Coil::GridMap (bool keep) {
+
+	AllocMaps();
+
+	// maps computed by an earlier run or process
+	string fname;
+	if (!m_map_cache.empty()) {
+		fname = m_map_cache + "/sensmap_" + MapHash() + ".h5";
+		if (ReadMap(fname)) {
+			BuildComplexMap();
+			if (!keep) ReleaseMaps();
+			return;
+		}
+	}
 
-    double position[3]  = {0.0,0.0,0.0};
-    double max = 0.0;
+	int rows = (m_dim==3?m_points:1) * m_points;
 
-    for (int k=0; k< (m_dim==3?m_points:1); k++) {
+	// in parallel jemris, the processes of a node already occupy its cores
+	int nthreads = 1;
+	if (ParallelMap() && World::instance()->m_no_processes == 1)
+		nthreads = (int) std::thread::hardware_concurrency();
+	if (nthreads < 1)    nthreads = 1;
+	if (nthreads > rows) nthreads = rows;
 
-        position [ZC] = (m_dim==3?k*m_extent/m_points-m_extent/2:0.0);
+	vector<double> max     (nthreads, 0.0);
+	vector<int>    complex (nthreads, 0);
+
+	if (nthreads == 1)
+		GridMapRows(0, 1, &max[0], &complex[0]);
+	else {
+		vector<std::thread> threads;
+		for (int t=0; t<nthreads; t++)
+			threads.push_back(std::thread(&Coil::GridMapRows, this, t, nthreads, &max[t], &complex[t]));
+		for (int t=0; t<nthreads; t++)
+			threads[t].join();
+	}
+
+	double mx = 0.0;
+	for (int t=0; t<nthreads; t++) {
+		mx = (mx>max[t]?mx:max[t]);
+		if (complex[t]) m_complex = true;
+	}
+	m_norm = 1/mx;
+	BuildComplexMap();
+
+	if (!fname.empty())
+		WriteMap(fname);
+
+	if (!keep) ReleaseMaps();
+
+}
 
-        for (int j=0; j<m_points; j++) {
+/**********************************************************/
+void Coil::GridMapRows (int first, int step, double* max, int* complex) {
+
+    double position[3]  = {0.0,0.0,0.0};
+    int    rows = (m_dim==3?m_points:1) * m_points;
 
-            position [YC] = j*m_extent/m_points-m_extent/2;
+    for (int r=first; r<rows; r+=step) {
 
-            for (int i=0; i<m_points; i++) {
+        int k = r / m_points;
+        int j = r % m_points;
 
-                position [XC] = i*m_extent/m_points-m_extent/2;
-                double mag   = m_scale*GetSensitivity(position);
-                m_sensmag(i,j,k) = mag;
-                max = (max>mag?max:mag);
-                m_senspha(i,j,k) = ( (m_conjugate?-1.0:1.0) * ( GetPhase(position) + m_phase) );
-                if (m_senspha(i,j,k) != 0.0) m_complex = true;
-            }
+        position [ZC] = (m_dim==3?k*m_extent/m_points-m_extent/2:0.0);
+        position [YC] = j*m_extent/m_points-m_extent/2;
+
+        for (int i=0; i<m_points; i++) {
+
+            position [XC] = i*m_extent/m_points-m_extent/2;
+            double mag, pha;
+            MapPoint(position, mag, pha);
+            mag *= m_scale;
+            m_sensmag(i,j,k) = mag;
+            *max = (*max>mag?*max:mag);
+            m_senspha(i,j,k) = ( (m_conjugate?-1.0:1.0) * ( pha + m_phase) );
+            if (m_senspha(i,j,k) != 0.0) *complex = 1;
         }
     }
-    m_norm = 1/max;
+
+}
+
+/**********************************************************/
+void Coil::MapPoint (const double* position, double& magnitude, double& phase) {
+
+	magnitude = GetSensitivity(position);
+	phase     = GetPhase(position);
+
+}
+
+/**********************************************************/
+string Coil::MapHash () {
+
+	// all XML attributes (e.g. the radius of a loop or an analytic expression) ...
+	vector<string> attrs;
+	DOMNamedNodeMap* map = m_node->getAttributes();
+	for (XMLSize_t i=0; map != NULL && i<map->getLength(); i++) {
+		DOMNode* attr = map->item(i);
+		attrs.push_back(StrX(attr->getNodeName()).std_str() + "=" + StrX(attr->getNodeValue()).std_str());
+	}
+	sort(attrs.begin(), attrs.end());
+
+	// ... and their evaluated values
+	stringstream s;
+	s << "1;" << StrX(m_node->getNodeName()).std_str() << ";" << setprecision(17);
+	for (unsigned int i=0; i<attrs.size(); i++)
+		s << attrs[i] << ";";
+	s << m_position[XC] << ";" << m_position[YC] << ";" << m_position[ZC] << ";" << m_azimuth << ";" << m_polar << ";"
+	  << m_scale << ";" << m_phase << ";" << m_conjugate << ";" << m_dim << ";" << m_extent << ";" << m_points;
+
+	// FNV-1a
+	string   str = s.str();
+	uint64_t h   = 14695981039346656037ULL;
+	for (size_t i=0; i<str.size(); i++) {
+		h ^= (unsigned char) str[i];
+		h *= 1099511628211ULL;
+	}
+
+	stringstream hex;
+	hex << std::hex << setw(16) << setfill('0') << h;
+	return hex.str();
+
+}
+
+/**********************************************************/
+bool Coil::ReadMap (const string& fname) {
+
+	ifstream test (fname.c_str());
+	if (!test.good())
+		return false;
+	test.close();
+
+	BinaryContext bc (fname, IO::IN);
+	if (bc.Status() != IO::OK)
+		return false;
+
+	AllocMaps();
+
+	NDData<double> mag, pha, info;
+	if (bc.Read(mag,  "magnitude", "/maps") != IO::OK ||
+	    bc.Read(pha,  "phase",     "/maps") != IO::OK ||
+	    bc.Read(info, "info",      "/maps") != IO::OK)
+		return false;
+	if (mag.Size() != m_sensmag.Size() || pha.Size() != m_senspha.Size() || info.Size() != 2)
+		return false;
+
+	memcpy (m_sensmag.Ptr(), mag.Ptr(), sizeof(double)*mag.Size());
+	memcpy (m_senspha.Ptr(), pha.Ptr(), sizeof(double)*pha.Size());
+	m_norm = info[0];
+	if (info[1] != 0.0) m_complex = true;
+
+	return true;
+
+}
+
+/**********************************************************/
+void Coil::WriteMap (const string& fname) {
+
+	// write to a file of this process, then move it in place
+	stringstream tmp;
+	tmp << fname << "." << World::instance()->m_myRank << ".tmp";
+
+	NDData<double> info (2);
+	info[0] = m_norm;
+	info[1] = (m_complex?1.0:0.0);
+
+	{
+		BinaryContext bc (tmp.str(), IO::OUT);
+		if (bc.Status() != IO::OK) {
+			cout << "Warning in " << GetName() << ": can not write sensitivity map cache " << tmp.str() << endl;
+			return;
+		}
+		bc.Write(m_sensmag, "magnitude", "/maps");
+		bc.Write(m_senspha, "phase",     "/maps");
+		bc.Write(info,      "info",      "/maps");
+	}
+
+	if (rename(tmp.str().c_str(), fname.c_str()) != 0)
+		remove(tmp.str().c_str());
 
 }
 
@@ -134,109 +296,189 @@ unsigned Coil::GetNDim () {
 }
 
 
+/**********************************************************/
+void    Coil::GetB1 (const double time, double& magnitude, double& phase) {
+
+    // shared with the Bloch equations and the other coils
+    double position[3];
+    World::instance()->SpinPosition(time, position);
+
+    GetB1(position, magnitude, phase);
+
+}
+
+/**********************************************************/
+void    Coil::GetB1 (const double* position, double& magnitude, double& phase) {
+
+	if (m_interpolate) {
+		double c[2];
+		InterpolateComplex(1, position, c);
+		magnitude = m_scale*sqrt(c[0]*c[0]+c[1]*c[1]);
+		phase     = (m_complex ? m_phase + (m_conjugate?-1.0:1.0) * atan2(c[1],c[0]) : m_phase);
+	} else {
+		magnitude = m_scale*GetSensitivity(position);
+		phase     = (m_complex ? m_phase + (m_conjugate?-1.0:1.0) * GetPhase(position) : m_phase);
+	}
+
+}
+
+/**********************************************************/
+void    Coil::GetB1 (const double* position, double* b1) {
+
+	if (m_interpolate) {
+		// scale*exp(i*phase) times the (conjugated) map, without polar decomposition
+		double c[2];
+		InterpolateComplex(1, position, c);
+		if (!m_complex) {
+			c[0] = sqrt(c[0]*c[0]+c[1]*c[1]);
+			c[1] = 0.0;
+		} else if (m_conjugate)
+			c[1] = -c[1];
+		b1[0] = m_weight[0]*c[0] - m_weight[1]*c[1];
+		b1[1] = m_weight[0]*c[1] + m_weight[1]*c[0];
+		return;
+	}
+
+	double magnitude, phase;
+	GetB1(position, magnitude, phase);
+	b1[0] = magnitude*cos(phase);
+	b1[1] = magnitude*sin(phase);
+
+}
+
 /**********************************************************/
 double  Coil::GetPhase (const double time) {
 
     if (!m_complex) return m_phase;
 
-    double position[3];
-    position[0]=World::instance()->Values[XC];
-    position[1]=World::instance()->Values[YC];
-    position[2]=World::instance()->Values[ZC];
-    DynamicVariables* dv = DynamicVariables::instance();
-    dv->m_Motion->GetValue(time,position);
-//MODIF
-    dv->m_Flow->GetValue(time,position);
-//MODIF***
-    dv->m_Respiration->GetValue(time,position);
-//Mod
-
-//
-
-    if (m_interpolate)
-		return ( m_phase + (m_conjugate?-1.0:1.0) * InterpolateSensitivity(position,false));
-	else
-		return ( m_phase + (m_conjugate?-1.0:1.0) * GetPhase(position));
+    double magnitude, phase;
+    GetB1(time, magnitude, phase);
+    return phase;
+
 }
 
 /**********************************************************/
 double  Coil::GetSensitivity (const double time) {
 
-    double position[3];
-    position[0]=World::instance()->Values[XC];
-    position[1]=World::instance()->Values[YC];
-    position[2]=World::instance()->Values[ZC];
-    DynamicVariables* dv = DynamicVariables::instance();
-    dv->m_Motion->GetValue(time,position);
-//MODIF
-    dv->m_Flow->GetValue(time,position);
-//MODIF***
-    dv->m_Respiration->GetValue(time,position);
-//Mod
-
-//
+    double magnitude, phase;
+    GetB1(time, magnitude, phase);
+    return magnitude;
 
-	if (m_interpolate) {
-		return m_scale*InterpolateSensitivity(position);
-	}
-	else {
-		return m_scale*GetSensitivity(position);
-	}
 }
 
 
 /**********************************************************/
 double Coil::InterpolateSensitivity (const double* position, bool magnitude){
 
+	double c[2];
+	InterpolateComplex(1, position, c);
+
+	return (magnitude ? sqrt(c[0]*c[0]+c[1]*c[1]) : atan2(c[1],c[0]));
+
+}
+
+/**********************************************************/
+void Coil::InterpolateComplex (const int n, const double* positions, double* values) const {
+
 	// expects  -m_extent/2 <= position[j] <= m_extent/2
-    double x = (position[XC]+m_extent/2)*m_points/m_extent;
-    double y = (position[YC]+m_extent/2)*m_points/m_extent;
-    double z = (m_dim==3?(position[ZC]+m_extent/2)*m_points/m_extent:0.0);
-	int    px   = int(x),  py   = int(y), pz   = int(z);
-	double normx = x-px ,	normy = y-py ,	normz = z-pz;
-
-	//check if point is on lattice
-	if (px>m_points-1 || px<0 || py>m_points-1 || py<0 || pz>m_points-1 || pz<0 ) return 0.0;
-
-    //bilinear interpolation (2D)
-	int nx = (px+1<m_points?px+1:m_points-1);
-	int ny = (py+1<m_points?py+1:m_points-1);
-	double i11, i21;
-	if (magnitude) {
-		i11 = m_sensmag(px,py,pz) + (m_sensmag(px,ny,pz)-m_sensmag(px,py,pz))*normy;
-		i21 = m_sensmag(nx,py,pz) + (m_sensmag(nx,ny,pz)-m_sensmag(nx,py,pz))*normy;
-	} else {
-		i11 = m_senspha(px,py,pz)+Unwrap(m_senspha(px,ny,pz)-m_senspha(px,py,pz),magnitude)*normy;
-		i21 = m_senspha(nx,py,pz)+Unwrap(m_senspha(nx,ny,pz)-m_senspha(nx,py,pz),magnitude)*normy;
+	const double  f    = m_points/m_extent;
+	const double  h    = m_extent/2;
+	const bool    d3   = (m_dim==3);
+	const int     last = m_points-1;
+	const int     lz   = (d3?last:0);
+	const double* map  = m_cplx;
+
+	for (int p=0; p<n; p++) {
+
+		const double* r = positions+3*p;
+		double x = (r[XC]+h)*f;
+		double y = (r[YC]+h)*f;
+		double z = (d3?(r[ZC]+h)*f:0.0);
+		int    px = int(x), py = int(y), pz = int(z);
+		double wx = x-px,   wy = y-py,   wz = z-pz;
+
+		// zero off the lattice; indices are clamped, such that no branch is needed
+		double in = (px>=0 && px<=last && py>=0 && py<=last && pz>=0 && pz<=lz) ? 1.0 : 0.0;
+		px = std::min(std::max(px,0),last);
+		py = std::min(std::max(py,0),last);
+		pz = std::min(std::max(pz,0),lz);
+		int nx = std::min(px+1,last);
+		int ny = std::min(py+1,last);
+		int nz = std::min(pz+1,lz);
+
+		const double* c000 = map + 2*Brick(px,py,pz);
+		const double* c100 = map + 2*Brick(nx,py,pz);
+		const double* c010 = map + 2*Brick(px,ny,pz);
+		const double* c110 = map + 2*Brick(nx,ny,pz);
+		const double* c001 = map + 2*Brick(px,py,nz);
+		const double* c101 = map + 2*Brick(nx,py,nz);
+		const double* c011 = map + 2*Brick(px,ny,nz);
+		const double* c111 = map + 2*Brick(nx,ny,nz);
+
+		// real and imaginary part
+		for (int c=0; c<2; c++) {
+			double i00 = c000[c] + (c010[c]-c000[c])*wy;
+			double i10 = c100[c] + (c110[c]-c100[c])*wy;
+			double i01 = c001[c] + (c011[c]-c001[c])*wy;
+			double i11 = c101[c] + (c111[c]-c101[c])*wy;
+			double iz0 = i00 + (i10-i00)*wx;
+			double iz1 = i01 + (i11-i01)*wx;
+			values[2*p+c] = in * (iz0 + (iz1-iz0)*wz);
+		}
+
 	}
-	double iz1 = i11+Unwrap(i21-i11,magnitude)*normx;
 
-	//check 2D
-	if (m_dim<3) return iz1;
+}
 
-    //trilinear interpolation (3D)
-	int nz = (pz+1<m_points?pz+1:m_points-1);
-	double i12, i22;
-	if (magnitude) {
-		i12 = m_sensmag(px,py,nz)+Unwrap(m_sensmag(px,ny,nz)-m_sensmag(px,py,nz),magnitude)*normy;
-		i22 = m_sensmag(nx,py,nz)+Unwrap(m_sensmag(nx,ny,nz)-m_sensmag(nx,py,nz),magnitude)*normy;
-	} else {
-		i12 = m_senspha(px,py,nz)+Unwrap(m_senspha(px,ny,nz)-m_senspha(px,py,nz),magnitude)*normy;
-		i22 = m_senspha(nx,py,nz)+Unwrap(m_senspha(nx,ny,nz)-m_senspha(nx,py,nz),magnitude)*normy;
+/**********************************************************/
+void Coil::AllocMaps () {
+
+	int nz = (m_dim==3?m_points:1);
+
+	if (m_sensmag.Size() != (size_t) m_points*m_points*nz) {
+		m_sensmag = NDData<double> (m_points, m_points, nz);
+		m_senspha = NDData<double> (m_points, m_points, nz);
 	}
-	double iz2 = i12+Unwrap(i22-i12,magnitude)*normx;
 
-	return (iz1+Unwrap(iz2-iz1,magnitude)*normz);
+}
+
+/**********************************************************/
+void Coil::ReleaseMaps () {
+
+	m_sensmag = NDData<double> ();
+	m_senspha = NDData<double> ();
+
+}
+
+/**********************************************************/
+void Coil::InitComplexMap () {
+
+	int nz = (m_dim==3?m_points:1);
+
+	m_bricks[XC] = (m_points+3)/4;
+	m_bricks[YC] = (m_points+3)/4;
+	m_bricks[ZC] = (nz+3)/4;
+	m_senscplx.assign(2*64*m_bricks[XC]*m_bricks[YC]*m_bricks[ZC], 0.0);
+	m_cplx = &m_senscplx[0];
 
 }
 
 /**********************************************************/
-double Coil::Unwrap(double checkwrap, bool magnitude){
-	// only for phase interpolation:
-	if (magnitude) return checkwrap;
-	const double wrapfact = 1; // factor to determine when a phase wrap is likely to be detected.
-	if (checkwrap>PI*wrapfact) checkwrap-=2*PI; if (checkwrap<-PI*wrapfact) checkwrap+=2*PI;
-	return checkwrap;
+void Coil::BuildComplexMap () {
+
+	int nz = (m_dim==3?m_points:1);
+
+	InitComplexMap();
+
+	// phase wraps need no treatment, as real and imaginary part are interpolated
+	for (int k=0; k<nz; k++)
+		for (int j=0; j<m_points; j++)
+			for (int i=0; i<m_points; i++) {
+				size_t b = 2*Brick(i,j,k);
+				m_senscplx[b  ] = m_sensmag(i,j,k) * cos(m_senspha(i,j,k));
+				m_senscplx[b+1] = m_sensmag(i,j,k) * sin(m_senspha(i,j,k));
+			}
+
 }
 
 /**********************************************************/
@@ -273,14 +515,17 @@ bool Coil::Prepare  (const PrepareMode mode) {
     success = Prototype::Prepare(mode);
 
     m_phase   *= PI/180.0;
+    m_weight[0] = m_scale*cos(m_phase);
+    m_weight[1] = m_scale*sin(m_phase);
     m_polar   *= PI/180.0;
     m_azimuth *= PI/180.0;
     m_interpolate = (m_points>0 && m_extent>0.0);
 
     // dimensions with m_points==0 may lead to undefined memory access
     if (m_points==0) m_points=1;
-    m_sensmag = NDData<double> (m_points, m_points, (m_dim==3?m_points:1));
-    m_senspha = NDData<double> (m_points, m_points, (m_dim==3?m_points:1));
+    // magnitude and phase maps are allocated on demand (GridMap), external maps do not need them
+    ReleaseMaps();
+    InitComplexMap();
 
     return success;
 
@@ -38,6 +38,8 @@
 
 class Coil : public Prototype {
 
+    friend class VirtualCoil;
+
  public:
 
     /**
@@ -59,6 +61,32 @@ class Coil : public Prototype {
      */
     double  GetPhase (const double time=0) ;
 
+    /**
+     * @brief Get the B1+ magnitude and phase at point (x,y,z) of the current spin
+     *
+     * @param time      Time point.
+     * @param magnitude Sensitivity with respect to spin in World
+     * @param phase     Phase with respect to spin in World
+     */
+    void    GetB1 (const double time, double& magnitude, double& phase);
+
+    /**
+     * @brief Get the B1+ magnitude and phase at point (x,y,z)
+     *
+     * @param position  At position.
+     * @param magnitude Sensitivity at position
+     * @param phase     Phase at position
+     */
+    void    GetB1 (const double* position, double& magnitude, double& phase);
+
+    /**
+     * @brief Get the complex B1+ at point (x,y,z)
+     *
+     * @param position  At position.
+     * @param b1        Real and imaginary part of the sensitivity at position
+     */
+    void    GetB1 (const double* position, double* b1);
+
     /**
      * @brief Interpolate the sensitivity at point (x,y,z)
      *
@@ -66,6 +94,15 @@ class Coil : public Prototype {
      */
     double InterpolateSensitivity (const double* position, bool magnitude=true);
 
+    /**
+     * @brief Interpolate the complex sensitivity map at a batch of positions
+     *
+     * @param n         Number of positions.
+     * @param positions Positions (x,y,z) one after the other.
+     * @param values    Real and imaginary part at each position.
+     */
+    void   InterpolateComplex (const int n, const double* positions, double* values) const;
+
     /**
      * @brief Get the B1+ magnitude at point (x,y,z)
      *
@@ -89,12 +126,31 @@ class Coil : public Prototype {
      */
     virtual double  GetPhase (const double* position) {return 0.0;};
 
+    /**
+     * @brief Get magnitude and phase at point (x,y,z) for the sensitivity map
+     *
+     * Evaluates GetSensitivity and GetPhase. Coils which override this method
+     * with a reentrant evaluation return true in ParallelMap; their maps are
+     * computed by several threads.
+     *
+     * @param position  At position.
+     * @param magnitude B1+ magnitude (unscaled).
+     * @param phase     B1+ phase [rad].
+     */
+    virtual void    MapPoint (const double* position, double& magnitude, double& phase);
+
+    /**
+     * @brief True, if MapPoint may be called by several threads at once
+     */
+    virtual bool    ParallelMap () const {return false;};
+
     /**
      * @brief Initialize my signal repository
      *
      * @param lADCs     Number of ADCs
+     * @param compact   Store Mx and My only, in single precision
      */
-    void    InitSignal     (long lADCs);
+    void    InitSignal     (long lADCs, bool compact = false);
 
     /**
      * @brief Receive signal from World
@@ -122,20 +178,28 @@ class Coil : public Prototype {
 
     /**
      * @brief Dump sensitivity map on the XML defined grid
+     *
+     * @param keep  Keep the magnitude and phase maps (for dumping them with MagnitudeMap and PhaseMap);
+     *              otherwise only the complex map used for interpolation is kept
+     */
+	void GridMap     (bool keep = false);
+
+    /**
+     * @brief Free the magnitude and phase maps (the complex map is kept)
      */
-	void GridMap     ();
+	void ReleaseMaps ();
 
     /**
      * @brief Map magnitudes
      *
-     * @return Magnitudes
+     * @return Magnitudes (after GridMap(true), until ReleaseMaps)
      */
 	double* MagnitudeMap     ();
 
     /**
      * @brief Map phases
      *
-     * @return phases
+     * @return phases (after GridMap(true), until ReleaseMaps)
      */
 	double* PhaseMap     ();
 
@@ -165,6 +229,21 @@ class Coil : public Prototype {
 
 	double GetNorm (){return m_norm;};
 
+    /**
+     * @brief True, if both coils interpolate their maps on the same grid
+     */
+	bool SameMapGrid (const Coil* c) const {
+		return (m_interpolate && c->m_interpolate && m_dim==c->m_dim && m_extent==c->m_extent && m_points==c->m_points);
+	};
+
+    /**
+     * @brief Set the directory in which computed sensitivity maps are cached
+     *
+     * Maps are stored as sensmap_<hash>.h5, where the hash is taken over the
+     * attributes of the coil. Empty: no caching.
+     */
+	void SetMapCache (const string& dir) {m_map_cache = dir;};
+
  protected:
 
     /**
@@ -180,6 +259,7 @@ class Coil : public Prototype {
     double			m_scale;   		/**< Scaling factor for sensitivities */
     double			m_norm;   		/**< Normalization factor for sensitivities */
     double			m_phase;   		/**< Constant phase shift */
+    double			m_weight[2];	/**< m_scale*exp(i*m_phase) */
     bool            m_interpolate;  /**< Whether to precompute sensitivities in an array */
     bool			m_complex;		/**< True, if sensitivity map is complex (non-zero phase entries).*/
     bool		    m_conjugate;	/**< Complex conjugate the sensitivites, if true.*/
@@ -187,10 +267,34 @@ class Coil : public Prototype {
     double			m_extent;  		/**< Array extend of support region [mm] */
     int				m_points;  		/**< Sampling points of the array */
 
-    NDData<double>  m_sensmag;
-    NDData<double>  m_senspha;
+    NDData<double>  m_sensmag;      /**< Magnitude map, only while the complex map is built or dumped */
+    NDData<double>  m_senspha;      /**< Phase map, only while the complex map is built or dumped */
+    vector<double>  m_senscplx;     /**< Real and imaginary part of the maps, interleaved, in bricks of 4x4x4 points */
+    const double*   m_cplx;         /**< The complex map used for interpolation (m_senscplx or a copy shared by the processes of a node) */
+    size_t          m_bricks[3];    /**< Number of bricks in x, y and z */
+
+    string          m_map_cache;    /**< Directory of cached sensitivity maps (empty: no caching) */
+
+    void   AllocMaps       (); /**< allocate magnitude and phase maps, if not yet done */
+
+    void   InitComplexMap  (); /**< allocate the complex map (zero) */
+
+    void   BuildComplexMap (); /**< fill the complex map from magnitude and phase maps */
+
+    /**
+     * @brief Index of a point in the complex map (in complex numbers)
+     */
+    inline size_t Brick (const int i, const int j, const int k) const {
+        return ((((k>>2)*m_bricks[YC] + (j>>2))*m_bricks[XC] + (i>>2)) << 6) + ((k&3)<<4) + ((j&3)<<2) + (i&3);
+    };
+
+    void   GridMapRows (int first, int step, double* max, int* complex); /**< compute every step-th row of the maps, starting with row first */
+
+    string MapHash  ();                     /**< hash of the attributes which determine the maps */
+
+    bool   ReadMap  (const string& fname);  /**< read maps from the cache; false, if not available */
 
-    double Unwrap(double diff,bool magnitude); /**< helper function to check for phase wraps in interpolation of phase maps. */
+    void   WriteMap (const string& fname);  /**< write maps to the cache */
 
 };
 
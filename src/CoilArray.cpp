@@ -25,13 +25,22 @@
  */
 
 #include "BinaryContext.h"
+#include "rng.h"
 #include "CoilArray.h"
 #include "Coil.h"
+#include "VirtualCoil.h"
+#include "Sample.h"
 #include "StrX.h"
 #include <sstream>
+#include <algorithm>
 #include "SequenceTree.h"
 #include "ConcatSequence.h"
 
+/**
+ * Maximum number of voxels from which the compression matrix is computed
+ */
+#define COMPRESSION_VOXELS 50000
+
 /***********************************************************/
 CoilArray::CoilArray () {
 
@@ -43,6 +52,11 @@ CoilArray::CoilArray () {
     m_senmap_prefix = "sensmaps";
     m_signal_output_dir = "";
     m_senmap_output_dir = "";
+    m_senmap_cache = "";
+    m_virtual_coils = 0;
+    m_expand  = false;
+    m_expanded = false;
+    m_compact = false;
     m_cpf     = new CoilPrototypeFactory();
     m_xio     = new XMLIO();
 
@@ -80,8 +94,10 @@ unsigned int CoilArray::Populate () {
 /***********************************************************/
 bool CoilArray::Prepare (const PrepareMode mode) {
 
-	for (unsigned int i=0; i<m_coils.size(); i++)
+	for (unsigned int i=0; i<m_coils.size(); i++) {
+		m_coils.at(i)->SetMapCache(m_senmap_cache);
 		m_coils.at(i)->Prepare(mode);
+	}
 
 	return true;
 
@@ -138,7 +154,7 @@ void CoilArray::Initialize (string uri) {
 void CoilArray::InitializeSignals (long lADCs) {
 
 	for (unsigned int i=0; i<GetSize(); i++)
-		m_coils[i]->InitSignal(lADCs);
+		m_coils[i]->InitSignal(lADCs, m_compact);
 
 }
 
@@ -150,6 +166,209 @@ void CoilArray::Receive (long lADC){
 
 }
 
+/**************************************************/
+void CoilArray::GetB1 (const double time, double* b1) {
+
+	double position[3];
+	World::instance()->SpinPosition(time, position);
+
+	b1[0] = 0.0;
+	b1[1] = 0.0;
+
+	for (unsigned int i=0; i<GetSize(); i++) {
+		double w[2];
+		m_coils[i]->GetB1(position, w);
+		b1[0] += w[0];
+		b1[1] += w[1];
+	}
+
+}
+
+/**********************************************************/
+/**
+ * @brief Eigen decomposition of a hermitian matrix (cyclic Jacobi method)
+ *
+ * @param n Dimension
+ * @param A Matrix (row major); holds the eigenvalues on the diagonal on return
+ * @param V Eigenvectors (columns) on return
+ */
+static void HermitianEigen (const int n, vector< std::complex<double> >& A, vector< std::complex<double> >& V) {
+
+	V.assign(n*n, 0.0);
+	for (int i=0; i<n; i++)
+		V[i*n+i] = 1.0;
+
+	for (int sweep=0; sweep<100; sweep++) {
+
+		double off = 0.0, diag = 0.0;
+		for (int i=0; i<n; i++) {
+			diag += norm(A[i*n+i]);
+			for (int j=i+1; j<n; j++)
+				off += norm(A[i*n+j]);
+		}
+		if (off <= 1e-30*diag)
+			break;
+
+		for (int p=0; p<n; p++)
+			for (int q=p+1; q<n; q++) {
+
+				double apq = abs(A[p*n+q]);
+				if (apq == 0.0)
+					continue;
+
+				// unitary scaling of q which makes a_pq real
+				std::complex<double> e = conj(A[p*n+q]) / apq;
+				for (int k=0; k<n; k++) {
+					A[k*n+q] *= e;
+					V[k*n+q] *= e;
+				}
+				for (int k=0; k<n; k++)
+					A[q*n+k] *= conj(e);
+
+				// real Jacobi rotation of p and q
+				double theta = (A[q*n+q].real() - A[p*n+p].real()) / (2.0*apq);
+				double t     = (theta<0.0?-1.0:1.0) / (fabs(theta) + sqrt(theta*theta+1.0));
+				double c     = 1.0 / sqrt(t*t+1.0);
+				double s     = t*c;
+
+				for (int k=0; k<n; k++) {
+					std::complex<double> akp = A[k*n+p], akq = A[k*n+q];
+					A[k*n+p] = c*akp - s*akq;
+					A[k*n+q] = s*akp + c*akq;
+					std::complex<double> vkp = V[k*n+p], vkq = V[k*n+q];
+					V[k*n+p] = c*vkp - s*vkq;
+					V[k*n+q] = s*vkp + c*vkq;
+				}
+				for (int k=0; k<n; k++) {
+					std::complex<double> apk = A[p*n+k], aqk = A[q*n+k];
+					A[p*n+k] = c*apk - s*aqk;
+					A[q*n+k] = s*apk + c*aqk;
+				}
+			}
+	}
+
+}
+
+/**********************************************************/
+void CoilArray::Compress (Sample* sample) {
+
+	int nc = m_coils.size();
+	int nv = m_virtual_coils;
+
+	if (nv <= 0 || nv >= nc || !m_physical.empty())
+		return;
+
+	for (int c=1; c<nc; c++)
+		if (!m_coils[0]->SameMapGrid(m_coils[c])) {
+			cout << "Warning: virtual coils need the sensitivity maps of all coils on the same grid"
+			     << " (Extent, Points, Dim). The receive array is not compressed." << endl;
+			return;
+		}
+
+	// covariance of the coil sensitivities over the voxels of the sample
+	size_t nvox = sample->GetSize() / sample->GetIsochromats();
+	size_t step = nvox / COMPRESSION_VOXELS + 1;
+	vector< std::complex<double> > R (nc*nc, 0.0), sens (nc), V;
+
+	for (size_t n=0; n<nvox; n+=step) {
+
+		double position[3];
+		sample->GetVoxelPosition(n, position);
+
+		for (int c=0; c<nc; c++) {
+			double mag, pha;
+			m_coils[c]->GetB1(position, mag, pha);
+			sens[c] = std::polar(mag, pha);
+		}
+
+		for (int i=0; i<nc; i++)
+			for (int j=0; j<nc; j++)
+				R[i*nc+j] += sens[i] * conj(sens[j]);
+	}
+
+	// the virtual coils are the principal components (left singular vectors)
+	HermitianEigen(nc, R, V);
+
+	vector<int> order (nc);
+	for (int i=0; i<nc; i++)
+		order[i] = i;
+	sort(order.begin(), order.end(), [&R,nc](int a, int b) { return R[a*nc+a].real() > R[b*nc+b].real(); });
+
+	double total = 0.0, kept = 0.0;
+	for (int i=0; i<nc; i++) {
+		total += R[order[i]*nc+order[i]].real();
+		if (i<nv) kept += R[order[i]*nc+order[i]].real();
+	}
+
+	vector< std::complex<double> > A (nv*nc);
+	for (int k=0; k<nv; k++)
+		for (int c=0; c<nc; c++)
+			A[k*nc+c] = conj(V[c*nc+order[k]]);
+
+	cout << "RxArray  : compressed " << nc << " coils to " << nv << " virtual coils, retained sensitivity energy "
+	     << (total>0.0?100.0*kept/total:100.0) << "%" << endl;
+
+	SetCompression(A);
+
+}
+
+/**********************************************************/
+void CoilArray::SetCompression (const vector< std::complex<double> >& A) {
+
+	if (A.empty() || !m_physical.empty())
+		return;
+
+	int nc = m_coils.size();
+	int nv = A.size() / nc;
+
+	m_compression = A;
+	m_physical    = m_coils;
+	m_coils.clear();
+
+	for (int k=0; k<nv; k++)
+		m_coils.push_back(new VirtualCoil(m_physical, &A[k*nc]));
+
+}
+
+/**********************************************************/
+void CoilArray::ExpandSignals () {
+
+	if (m_physical.empty() || !m_expand)
+		return;
+
+	int   nc = m_physical.size();
+	int   nv = m_coils.size();
+	long  ns = m_coils[0]->GetSignal()->Repo()->Samples();
+
+	for (int c=0; c<nc; c++) {
+
+		m_physical[c]->InitSignal(ns, m_compact);
+		Repository* r = m_physical[c]->GetSignal()->Repo();
+		memcpy (r->Times(), m_coils[0]->GetSignal()->Repo()->Times(), ns * sizeof(double));
+
+		// the signal of the physical coils is the back projection of the virtual coils
+		for (int k=0; k<nv; k++) {
+			std::complex<double> a = conj(m_compression[k*nc+c]);
+			Repository* v = m_coils[k]->GetSignal()->Repo();
+			for (long i=0; i<ns; i++)
+				for (int j=0; j<r->Compartments(); j++) {
+					long p = i*r->NProps() + j*r->Stride();
+					std::complex<double> m = a * std::complex<double>(v->Value(p), v->Value(p+1));
+					r->Add (p  , m.real());
+					r->Add (p+1, m.imag());
+				}
+		}
+	}
+
+	for (int k=0; k<nv; k++)
+		delete m_coils[k];
+
+	m_coils = m_physical;
+	m_physical.clear();
+	m_expanded = true;
+
+}
+
 /**********************************************************/
 IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 
@@ -172,7 +391,6 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 	for (int c = 0; c < GetSize(); c++) {
 		
 		Repository* repository = m_coils[c]->GetSignal()->Repo();
-		RNG*        rng        = m_coils[c]->GetSignal()->Noise();
 
 		if (normalize) {
 				
@@ -180,7 +398,7 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 				for (long i = 0; i < repository->Samples(); i++) {	
 
 					for (int j = 0; j < repository->NProps(); j++) 
-						(*repository)[i*repository->NProps() + j] /= World::instance()->TotalSpinNumber;
+						repository->Set (i*repository->NProps() + j, repository->Value (i*repository->NProps() + j) / World::instance()->TotalSpinNumber);
 					
 				
 					//dwelltime-weighted random noise
@@ -193,8 +411,10 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 					
 						//definition: Gaussian has std-dev World::instance()->RandNoise at a dwell-time of 0.01 ms
 						for (int j = 0; j < repository->Compartments(); j++) {
-						(*repository)[i*repository->NProps() + j*3 + 0] += World::instance()->LargestM0*World::instance()->RandNoise*rng->normal()*0.1/sqrt(dt);
-						(*repository)[i*repository->NProps() + j*3 + 1] += World::instance()->LargestM0*World::instance()->RandNoise*rng->normal()*0.1/sqrt(dt);
+						double nx, ny;
+						RNG::normal2 (World::instance()->m_seed, c*repository->Compartments() + j, RNG_NOISE, i, nx, ny);
+						repository->Add (i*repository->NProps() + j*repository->Stride() + 0, World::instance()->LargestM0*World::instance()->RandNoise*nx*0.1/sqrt(dt));
+						repository->Add (i*repository->NProps() + j*repository->Stride() + 1, World::instance()->LargestM0*World::instance()->RandNoise*ny*0.1/sqrt(dt));
 					}
 				}
 
@@ -205,10 +425,28 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 		stringstream sstr;
 		sstr << setw(2) << setfill('0') << c;
 
-		di = NDData<double> (repository->Samples(), repository->NProps());
-		memcpy (&di[0], repository->Data(), di.Size() * sizeof(double));
 		URN = sstr.str();
-		bc.Write(di, URN, "/signal/channels/");
+		if (repository->Compact()) {
+			// Mx, My per compartment in single precision
+			NDData<float> df (repository->Samples(), repository->NProps());
+			repository->Fold();
+			memcpy (&df[0], repository->Buffer(), df.Size() * sizeof(float));
+			bc.Write(df, URN, "/signal/channels/");
+		} else if (m_expanded && repository->Stride() > 2) {
+			// expanded signals: Mx, My per compartment, Mz is unknown
+			di = NDData<double> (repository->Samples(), 2*repository->Compartments());
+			for (long i = 0; i < repository->Samples(); i++)
+				for (int j = 0; j < repository->Compartments(); j++) {
+					long p = i*repository->NProps() + j*repository->Stride();
+					di[2*(i*repository->Compartments()+j)  ] = repository->Value(p);
+					di[2*(i*repository->Compartments()+j)+1] = repository->Value(p+1);
+				}
+			bc.Write(di, URN, "/signal/channels/");
+		} else {
+			di = NDData<double> (repository->Samples(), repository->NProps());
+			memcpy (&di[0], repository->Data(), di.Size() * sizeof(double));
+			bc.Write(di, URN, "/signal/channels/");
+		}
 		
 		if (URN == "00") {
 			di = NDData<double> (repository->Samples());
@@ -216,6 +454,13 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 			bc.Write(di, "times", "/signal");
 		}
 
+		// channels are virtual coils: store the compression matrix (real/imag, physical, virtual coils)
+		if (URN == "00" && !m_physical.empty()) {
+			di = NDData<double> (2, m_physical.size(), GetSize());
+			memcpy (&di[0], &m_compression[0], di.Size() * sizeof(double));
+			bc.Write(di, "compression", "/signal");
+		}
+
 
 	}
 
@@ -225,20 +470,15 @@ IO::Status CoilArray::DumpSignals (string prefix, bool normalize) {
 }
 
 /**********************************************************/
-IO::Status CoilArray::DumpSignalsISMRMRD (string prefix, bool normalize) {
+IO::Status CoilArray::DumpSignalsISMRMRD (const std::string& header, std::vector<ISMRMRD::Acquisition>& acqs, string prefix, bool normalize) {
 
 	if (m_normalized) // WIP parameter to check if signal was already normalized by DumpSignals(). Can be removed, if DumpSignals is removed.
 		normalize = false;
 
-	// Open ISMRMRD dataset containing sequence data
-	ISMRMRD::Dataset d_tmp((m_signal_output_dir + m_signal_prefix + prefix + "_tmp.h5").c_str(), "dataset", false);
-	std::string xml;
-    d_tmp.readHeader(xml);
-
 	// Write new file containing both sequence and signal data
 	std::remove((m_signal_output_dir + m_signal_prefix + prefix + ".h5").c_str());
 	ISMRMRD::Dataset d((m_signal_output_dir + m_signal_prefix + prefix + ".h5").c_str(), "dataset", true);
-	d.writeHeader(xml);
+	d.writeHeader(header);
 
 	ISMRMRD::Acquisition acq;
 
@@ -251,9 +491,10 @@ IO::Status CoilArray::DumpSignalsISMRMRD (string prefix, bool normalize) {
 		acq.resize(dims[0]*dims[1], dims[2], 3);
 
 		for (unsigned i = 0; i < m_coils.size(); ++i) {
-			m_coils[i]->GridMap();
+			m_coils[i]->GridMap(true);
 			memcpy (&mag[0], m_coils[i]->MagnitudeMap(), sizeof(double)*mag.Size());
 			memcpy (&pha[0], m_coils[i]->PhaseMap(), sizeof(double)*mag.Size());
+			m_coils[i]->ReleaseMaps();
 			for(size_t x = 0; x < dims[0]; ++x){
 				for(size_t y = 0; y < dims[1]; ++y){
 					for(size_t z = 0; z < dims[2]; ++z)
@@ -275,20 +516,17 @@ IO::Status CoilArray::DumpSignalsISMRMRD (string prefix, bool normalize) {
 		printf("Coil size too big to save it in ISMRMRD file. Number of points should not exceed 255."); // has to be < sqrt(65535)
 	}
 
-	// Dump data to ISMRMRD file
-	std::vector<ISMRMRD::Acquisition> acqList;
-	int offset = 0;
+	// normalize and add noise
 	for (int c = 0; c < GetSize(); c++) {
 
 		Repository* repository = m_coils[c]->GetSignal()->Repo();
-		RNG*        rng        = m_coils[c]->GetSignal()->Noise();
 
 		for (long i = 0; i < repository->Samples(); i++) {
 			
 			if (normalize) {
 				
 				for (int j = 0; j < repository->NProps(); j++) 
-					(*repository)[i*repository->NProps() + j] /= World::instance()->TotalSpinNumber;
+					repository->Set (i*repository->NProps() + j, repository->Value (i*repository->NProps() + j) / World::instance()->TotalSpinNumber);
 				
 				//dwelltime-weighted random noise
 				if (World::instance()->RandNoise > 0.0) {
@@ -300,8 +538,10 @@ IO::Status CoilArray::DumpSignalsISMRMRD (string prefix, bool normalize) {
 					
 					//definition: Gaussian has std-dev World::instance()->RandNoise at a dwell-time of 0.01 ms
 					for (int j = 0; j < repository->Compartments(); j++) {
-						(*repository)[i*repository->NProps() + j*3 + 0] += World::instance()->RandNoise*rng->normal()*0.1/sqrt(dt);
-						(*repository)[i*repository->NProps() + j*3 + 1] += World::instance()->RandNoise*rng->normal()*0.1/sqrt(dt);
+						double nx, ny;
+						RNG::normal2 (World::instance()->m_seed, c*repository->Compartments() + j, RNG_NOISE, i, nx, ny);
+						repository->Add (i*repository->NProps() + j*repository->Stride() + 0, World::instance()->RandNoise*nx*0.1/sqrt(dt));
+						repository->Add (i*repository->NProps() + j*repository->Stride() + 1, World::instance()->RandNoise*ny*0.1/sqrt(dt));
 					}
 					
 				}
@@ -309,50 +549,36 @@ IO::Status CoilArray::DumpSignalsISMRMRD (string prefix, bool normalize) {
 			}
 			
 		}
-		NDData<double> di (repository->NProps(), repository->Samples());
-		memcpy (&di[0], repository->Data(), di.Size() * sizeof(double));
 
-		if (c==0){
-			for (int n = 0; n < d_tmp.getNumberOfAcquisitions(); ++n){
+	}
 
-				d_tmp.readAcquisition(n, acq);
+	// stream the acquisitions: fill in the samples of all coils and append right away
+	long offset = 0;
+	for (size_t n = 0; n < acqs.size(); ++n) {
 
-				if (!acq.isFlagSet(ISMRMRD::ISMRMRD_ACQ_USER1)){ // USER1 flag is set for TPOI's without ADCs
+		if (acqs[n].isFlagSet(ISMRMRD::ISMRMRD_ACQ_USER1)) // USER1 flag is set for TPOI's without ADCs
+			continue;
 
-					acq.resize(acq.number_of_samples(), GetSize(), acq.trajectory_dimensions()); // set number of coils
-					for (int s = 0; s < acq.number_of_samples(); ++s){
-						std::complex<float> sig (di(0,offset+s), di(1,offset+s));
-						acq.data(s,c) = sig;
-					}
-					acqList.push_back(acq);
-					offset += acq.number_of_samples();
-				}
-			}
-		}
-		else{
-			offset = 0;
-			for(int n = 0; n<acqList.size(); ++n){
-				for (int s = 0; s < acqList[n].number_of_samples(); ++s){
-						std::complex<float> sig (di(0,offset+s), di(1,offset+s));
-						acqList[n].data(s,c) = sig;
-				}
-				offset += acqList[n].number_of_samples();
+		acqs[n].resize(acqs[n].number_of_samples(), GetSize(), acqs[n].trajectory_dimensions()); // set number of coils
+		for (int c = 0; c < GetSize(); c++) {
+			Repository* repository = m_coils[c]->GetSignal()->Repo();
+			for (int s = 0; s < acqs[n].number_of_samples() && offset+s < repository->Samples(); ++s) {
+				long p = (offset+s) * repository->NProps();
+				acqs[n].data(s,c) = std::complex<float> (repository->Value(p), repository->Value(p+1));
 			}
 		}
+		d.appendAcquisition(acqs[n]);
+		offset += acqs[n].number_of_samples();
 
-	}
-
-	// Write acquisitions from acqList
-	for(int n = 0; n< acqList.size(); ++n)
-		d.appendAcquisition(acqList[n]);
+		// the acquisition is on disk now
+		acqs[n] = ISMRMRD::Acquisition();
 
+	}
 
 	Repository* repository = m_coils[0]->GetSignal()->Repo();
 	if(offset != repository->Samples())
 		cout << "Not all signal samples written to ISMRMRD file. Number of unwritten samples: " << repository->Samples() - offset << endl;
 
-	std::remove((m_signal_output_dir + m_signal_prefix + prefix + "_tmp.h5").c_str());
-
 	return IO::OK;
 
 }
@@ -372,9 +598,10 @@ IO::Status CoilArray::DumpSensMaps (bool verbose) {
 	for (unsigned i = 0; i < m_coils.size(); ++i) {
 		stringstream sstr;
 		sstr << setw(2) << setfill('0') << i;
-		m_coils[i]->GridMap();
+		m_coils[i]->GridMap(true);
 		memcpy (&mag[0], m_coils[i]->MagnitudeMap(), sizeof(double)*mag.Size());
 		memcpy (&pha[0], m_coils[i]->PhaseMap(), sizeof(double)*mag.Size());
+		m_coils[i]->ReleaseMaps();
 	    bc.Write (mag, sstr.str(), "/maps/magnitude");
 	    bc.Write (pha, sstr.str(), "/maps/phase");
 	}
@@ -395,39 +622,3 @@ Coil* CoilArray::GetCoil(unsigned channel) {
 		return NULL;
 }
 
-/**********************************************************/
-int CoilArray::ReadRestartSignal(){
-
-	/*	// return: 0, if files successfully read; -2 if no files present; -1 if wrong restart files.
-	bool fail = false;
-	for (unsigned int i=0; i<GetSize();i++) {
-		Repository rep = m_coils[i]->GetSignal()->m_repository;
-		ifstream tmp;
-	    stringstream sstr;
-		sstr << ".tmp_sig" << setw(2) << setfill('0') << i+1 << ".bin";
-		tmp.open(sstr.str().c_str(), ifstream::binary);
-		if (!tmp.is_open()) {
-			if (i==0) return (-2); else fail=true;
-		}
-		tmp.seekg (0, ios::end);
-		// REVISE works only for single compartment
-		int length = tmp.tellg()/sizeof(double)/4;
-		if (length != rep.size) fail=true;
-		if (fail) {
-			tmp.close();
-			for (unsigned int j=0;j<GetSize();j++) {
-				m_coils[j]->InitSignal(rep.size);
-			}
-			return (-1);
-		}
-		tmp.seekg (0, ios::beg);
-		for (int k=0; k<length;k++) {
-			tmp.read ((char*) &(rep.tp[k]),sizeof(double));
-			tmp.read ((char*) &(rep.mx[k]),sizeof(double));
-			tmp.read ((char*) &(rep.my[k]),sizeof(double));
-			tmp.read ((char*) &(rep.mz[k]),sizeof(double));
-		}
-		tmp.close();
-		}*/
-	return (0);
-}
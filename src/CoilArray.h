@@ -32,7 +32,12 @@
 #include "Signal.h"
 #include "CoilPrototypeFactory.h"
 
+#include <complex>
+
+#include "ismrmrd/ismrmrd.h"
+
 class Coil;
+class Sample;
 
 /**
  *  @brief Coil configuration and sensitivities
@@ -106,6 +111,16 @@ class CoilArray  {
      */
     void Receive           (long lADC);
 
+    /**
+     * @brief Sum of the complex B1+ of all my coils for the spin in World
+     *
+     * Parallel transmit with the same waveform on every channel.
+     *
+     * @param time Time point.
+     * @param b1   Real and imaginary part of the summed sensitivities
+     */
+    void GetB1             (const double time, double* b1);
+
     /**
      * @brief Dump all signals
      * Dump the signals from all coils to discrete files.
@@ -115,8 +130,14 @@ class CoilArray  {
     /**
      * @brief Dump all signals
      * Dump the signals from all coils to ISMRMRD file.
+     * The acquisitions are filled with the signals and appended one by one.
+     *
+     * @param header    Serialized ISMRMRD header of the sequence
+     * @param acqs      Acquisitions of the sequence (released once written)
+     * @param prefix    File name suffix
+     * @param normalize Normalize the signals, if not done by DumpSignals
      */
-	IO::Status DumpSignalsISMRMRD       (string prefix = "_ismrmrd", bool normalize = true);
+	IO::Status DumpSignalsISMRMRD       (const std::string& header, std::vector<ISMRMRD::Acquisition>& acqs, string prefix = "_ismrmrd", bool normalize = true);
 
     /**
      * @brief Dump all sensitivities
@@ -138,6 +159,65 @@ class CoilArray  {
 
     string GetSenMaplPrefix      () {return m_senmap_prefix;};
 
+    /**
+     * @brief Set sensitivity map cache directory
+     * Computed sensitivity maps are stored there and reused by later runs and processes
+     * @param dir the directory (it is assumed that it exists; empty: no caching)
+     */
+    void SetSenMapCache       (string dir) {m_senmap_cache = dir;};
+
+    /**
+     * @brief Set the number of virtual coils
+     * The receive array is compressed to this number of virtual coils before the simulation
+     * @param n number of virtual coils (0: no compression)
+     */
+    void SetVirtualCoils      (int n) {m_virtual_coils = n;};
+
+    /**
+     * @brief Expand the signals of the virtual coils to the physical coils before dumping
+     * @param val true: expand
+     */
+    void SetExpandSignals     (bool val) {m_expand = val;};
+
+    /**
+     * @brief Store the signals compactly
+     * Only Mx and My are kept, in single precision with compensated summation.
+     * Signals are transferred and dumped in single precision as well.
+     * @param val true: compact signals
+     */
+    void SetCompactSignals    (bool val) {m_compact = val;};
+
+    /**
+     * @brief Compress the receive array to virtual coils
+     *
+     * The compression matrix holds the principal components of the sensitivities
+     * of the physical coils at the voxels of the sample (SVD of the coil sensitivity
+     * matrix). Afterwards, the channels of the array are the virtual coils.
+     *
+     * @param sample The sample defining the support
+     */
+    void Compress             (Sample* sample);
+
+    /**
+     * @brief Compress the receive array with a given compression matrix
+     * @param A compression matrix (virtual coils x physical coils, row major; empty: no compression)
+     */
+    void SetCompression       (const vector< std::complex<double> >& A);
+
+    /**
+     * @brief Get the compression matrix
+     * @return compression matrix (virtual coils x physical coils, row major; empty: no compression)
+     */
+    const vector< std::complex<double> >& GetCompression () {return m_compression;};
+
+    /**
+     * @brief Expand the signals of the virtual coils to the physical coils, if requested
+     * Afterwards, the channels of the array are the physical coils. The longitudinal
+     * magnetization is received with the magnitude of the sensitivity and can not be
+     * expanded; it is left out of the dump (Mx, My per compartment, as for compact signals).
+     */
+    void ExpandSignals        ();
+
     /**
      * @brief Set SensMap output directory
      * Directory the SensMap is saved to
@@ -178,20 +258,22 @@ class CoilArray  {
      */
     void setMode (unsigned short mode) { m_mode = mode; }
 
-    /**
-     * @brief reads restart signal.
-     */
-    int ReadRestartSignal();
-
  private:
 
-    vector<Coil*>         m_coils;         /**< @brief My coils         */
+    vector<Coil*>         m_coils;         /**< @brief My coils (virtual coils, if compressed) */
+    vector<Coil*>         m_physical;      /**< @brief Physical coils, if compressed */
+    vector< std::complex<double> > m_compression; /**< @brief Compression matrix (virtual x physical coils) */
+    int                   m_virtual_coils; /**< @brief Requested number of virtual coils (0: no compression) */
+    bool                  m_expand;        /**< @brief Expand the signals to the physical coils before dumping */
+    bool                  m_expanded;      /**< @brief Signals were expanded from virtual coils (no Mz) */
+    bool                  m_compact;       /**< @brief Compact signals (Mx, My in single precision) */
     double                m_radius;        /**< @brief My radius        */
     unsigned short        m_mode;          /**< @brief My mode (RX/TX)  */
     string	              m_signal_prefix; /**< @brief prefix string to signal binary filenames */
     string	              m_senmap_prefix; /**< @brief prefix string to sensitivity map filenames */
     string	              m_signal_output_dir;  /**< @brief string to signal directory            */
     string	              m_senmap_output_dir;  /**< @brief string to sensitivity map directory   */
+    string	              m_senmap_cache;       /**< @brief directory of cached sensitivity maps  */
 
     CoilPrototypeFactory* m_cpf;           /**< @brief Coil factory    */
     DOMDocument*          m_dom_doc;       /**< @brief DOM document containing configuration */
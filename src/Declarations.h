@@ -82,8 +82,8 @@ enum polar {
  * the sequence.
  */
 enum seqval {
-	RF_AMP,                             /**< @brief Amplitude */
-	RF_PHS,                             /**< @brief Phase     */
+	RF_X,                               /**< @brief B1 real part      */
+	RF_Y,                               /**< @brief B1 imaginary part */
 	GRAD_X,                             /**< @brief Readout   */
 	GRAD_Y,                             /**< @brief Phase     */
 	GRAD_Z,                             /**< @brief Slice     */
@@ -64,28 +64,69 @@ bool ExternalCoil::Prepare (const PrepareMode mode) {
 /**********************************************************/
 IO::Status ExternalCoil::LoadMap () {
 
-	BinaryContext bc (m_fname, IO::IN);
-	if (bc.Status() != IO::OK)
-		return bc.Status();
+	// parallel jemris: only the first slave of a node reads the maps, the others share its copy
+	World* pW     = World::instance();
+	bool   shared = (pW->shareFunPtr != NULL);
 
-	NDData<double> tmpdat;
+	IO::Status ios = IO::OK;
 
-	if (bc.Read(tmpdat, "magnitude", "/maps") != IO::OK)
-		return bc.Status();
+	if (!shared || pW->m_node_rank == 0)
+		ios = ReadSlabs();
 
-	// no 'int pow(int,int)' available! Use cast and add delta to avoid roundoff error.
-	int size = (int) (pow((double) m_points,(double) m_dim) + 1e-20);
+	if (shared) {
+		size_t expected = m_senscplx.size() * sizeof(double);
+		size_t bytes    = (ios == IO::OK) ? expected : 0;
+		const double* map = (const double*) pW->shareFunPtr(m_senscplx.data(), bytes);
+		vector<double>().swap(m_senscplx);
+		m_cplx = map;
+		if (bytes != expected)
+			return (ios == IO::OK) ? IO::UNMATCHED_DIMENSIONS : ios;
+	}
 
-	memcpy (m_sensmag.Ptr(), &tmpdat[0], size * sizeof(double));
+	m_complex = true;
 
-	if (bc.Read(tmpdat, "phase", "/maps") != IO::OK)
-		return bc.Status();
+	return ios;
 
-	memcpy (m_senspha.Ptr(), &tmpdat[0], size * sizeof(double));
+}
 
-	m_complex=true;
+/**********************************************************/
+IO::Status ExternalCoil::ReadSlabs () {
+
+	BinaryContext bc (m_fname, IO::IN);
+	if (bc.Status() != IO::OK)
+		return bc.Status();
+
+	InitComplexMap();
+
+	// slowest dimension of the maps: z slices in 3D, y rows in 2D
+	size_t plane  = (m_dim==3 ? m_points*m_points : m_points);
+	size_t total  = m_points;
+	NDData<double> mag, pha;
+
+	// read few slices at a time, directly into the complex map
+	for (size_t first=0; first<total; first+=4) {
+
+		size_t count = 4, count2 = 4, n = 0;
+		IO::Status ios;
+		if ((ios = bc.ReadSlab(mag, "magnitude", "/maps", first, count,  n)) != IO::OK)
+			return ios;
+		if ((ios = bc.ReadSlab(pha, "phase",     "/maps", first, count2, n)) != IO::OK)
+			return ios;
+		if (n != total || count != count2 || mag.Size() != count*plane || pha.Size() != count*plane)
+			return IO::UNMATCHED_DIMENSIONS;
+
+		for (size_t p=0; p<count*plane; p++) {
+			size_t f = first*plane + p;
+			int    i = f % m_points;
+			int    j = (f / m_points) % m_points;
+			int    k = f / (m_points*m_points);
+			size_t b = 2*Brick(i,j,k);
+			m_senscplx[b  ] = mag[p] * cos(pha[p]);
+			m_senscplx[b+1] = mag[p] * sin(pha[p]);
+		}
+
+	}
 
 	return IO::OK;
 
 }
-
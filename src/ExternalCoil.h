@@ -85,10 +85,21 @@ class ExternalCoil : public Coil {
      */
     virtual bool Prepare  (const PrepareMode mode);
 
+    /**
+     * @brief Load the sensitivity map
+     *
+     * Magnitude and phase are read slice by slice into the complex map.
+     * In parallel jemris, the first slave of a node reads the map and
+     * shares it with the other slaves of the node.
+     *
+     * @return     Status
+     */
 	IO::Status LoadMap ();
 
  private:
 
+	IO::Status ReadSlabs (); /**< read magnitude and phase in slabs of slices */
+
      string    m_fname;        /**< @brief URI of the sensitivity map  */
 
 };
@@ -177,6 +177,61 @@ public:
 
 	}
 
+	/**
+	 * @brief     Read consecutive entries of the slowest varying dimension (e.g. slices of a map)
+	 *
+	 * @param  data   Data container (resized to the slab)
+	 * @param  first  First entry of the slowest dimension
+	 * @param  count  Number of entries; reduced at the end of the dataset
+	 * @param  total  Extent of the slowest dimension in the file
+	 */
+	template<class T> IO::Status
+	ReadSlab (NDData<T>& data, const std::string& urn, const std::string& url, const size_t first, size_t& count, size_t& total) {
+
+		try {
+
+#ifndef VERBOSE
+			H5::Exception::dontPrint();
+#endif
+			H5::DataSet   dset   = m_file.openDataSet(URI(url,urn));
+			H5::DataSpace dspace = dset.getSpace();
+			int           ndim   = dspace.getSimpleExtentNdims();
+			std::vector<hsize_t> dims (ndim), offset (ndim, 0);
+			dspace.getSimpleExtentDims(&dims[0], NULL);
+
+			total = dims[0];
+			if (first >= total)
+				count = 0;
+			else if (first + count > total)
+				count = total - first;
+
+			if (count > 0) {
+				dims[0]   = count;
+				offset[0] = first;
+				data      = NDData<T> (dims);
+				dspace.selectHyperslab(H5S_SELECT_SET, &dims[0], &offset[0]);
+				H5::DataSpace mspace (ndim, &dims[0]);
+				dset.read(data.Ptr(), HDF5Types<T>::Type(), mspace, dspace);
+				mspace.close();
+			}
+
+			dspace.close();
+			dset.close();
+
+		} catch (const H5::FileIException&      e) {
+			return ReportException (e, IO::HDF5_FILE_I_EXCEPTION);
+		} catch (const H5::DataSetIException&   e) {
+			return ReportException (e, IO::HDF5_DATASET_I_EXCEPTION);
+		} catch (const H5::DataSpaceIException& e) {
+			return ReportException (e, IO::HDF5_DATASPACE_I_EXCEPTION);
+		} catch (const H5::DataTypeIException&  e) {
+			return ReportException (e, IO::HDF5_DATATYPE_I_EXCEPTION);
+		}
+
+		return IO::OK;
+
+	}
+
 	virtual IO::Status
 	FileAccess    () {
 
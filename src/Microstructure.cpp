@@ -36,6 +36,10 @@ Microstructure::Microstructure() {
 
 	m_rng = NULL;
 
+	m_index_built=false;
+	m_index_n=0;
+	m_index_h=0.0;
+
 }
 
 Microstructure::~Microstructure() {
@@ -49,3 +53,82 @@ triple Microstructure::PeriodicBoundary(triple trialpos) {
 	pos.z = fmod(trialpos.z+m_boxsize , edge)-m_boxsize;
 	return pos;
 }
+/**************************************************/
+bool Microstructure::Candidates(const triple &pos, const int* &ids, int &n) {
+
+	if (!m_index_built) BuildIndex();
+	if (m_index_n == 0 || !isInsideBox(pos)) return false;
+
+	int i = (int) ((pos.x+m_boxsize)/m_index_h);
+	int j = (int) ((pos.y+m_boxsize)/m_index_h);
+	int k = (int) ((pos.z+m_boxsize)/m_index_h);
+	if (i >= m_index_n) i = m_index_n-1;
+	if (j >= m_index_n) j = m_index_n-1;
+	if (k >= m_index_n) k = m_index_n-1;
+
+	int c = (k*m_index_n + j)*m_index_n + i;
+	n   = m_index_first[c+1] - m_index_first[c];
+	ids = m_index_ids.data() + m_index_first[c];
+	return true;
+
+}
+/**************************************************/
+void Microstructure::BuildIndex() {
+
+	m_index_built = true;
+	m_index_n     = 0;
+	m_index_first.clear();
+	m_index_ids.clear();
+
+	int nobj = NumObjects();
+	if (nobj < 8) return;	// testing all objects is as fast
+
+	// about eight objects per cell in a dense structure
+	m_index_n = (int) ceil(pow(8.0*nobj, 1.0/3.0));
+	if (m_index_n > 64) m_index_n = 64;
+	m_index_h = 2*m_boxsize/m_index_n;
+
+	// insert objects in ascending order, such that lookups find the same object as a linear search
+	vector< vector<int> > cells (m_index_n*m_index_n*m_index_n);
+	int lo[3] = {0, 0, 0};
+	int hi[3] = {m_index_n, m_index_n, m_index_n};
+	for (int id=0; id<nobj; id++)
+		InsertObject(id, lo, hi, cells);
+
+	m_index_first.resize(cells.size()+1);
+	m_index_first[0] = 0;
+	for (size_t c=0; c<cells.size(); c++) {
+		m_index_first[c+1] = m_index_first[c] + cells[c].size();
+		m_index_ids.insert(m_index_ids.end(), cells[c].begin(), cells[c].end());
+	}
+
+}
+/**************************************************/
+void Microstructure::InsertObject(int id, const int* lo, const int* hi, vector< vector<int> > &cells) {
+
+	// block of cells [lo..hi): test the sphere around it
+	triple center;
+	center.x = -m_boxsize + 0.5*(lo[0]+hi[0])*m_index_h;
+	center.y = -m_boxsize + 0.5*(lo[1]+hi[1])*m_index_h;
+	center.z = -m_boxsize + 0.5*(lo[2]+hi[2])*m_index_h;
+	double e0 = hi[0]-lo[0], e1 = hi[1]-lo[1], e2 = hi[2]-lo[2];
+	double radius = 0.5*m_index_h*sqrt(e0*e0 + e1*e1 + e2*e2);
+	if (!ObjectNear(id, center, radius)) return;
+
+	// single cell
+	int d = 0;
+	for (int i=1; i<3; i++) if (hi[i]-lo[i] > hi[d]-lo[d]) d = i;
+	if (hi[d]-lo[d] == 1) {
+		cells[(lo[2]*m_index_n + lo[1])*m_index_n + lo[0]].push_back(id);
+		return;
+	}
+
+	// split the longest edge
+	int mid[3] = {hi[0], hi[1], hi[2]};
+	mid[d] = (lo[d]+hi[d])/2;
+	InsertObject(id, lo, mid, cells);
+	mid[0] = lo[0]; mid[1] = lo[1]; mid[2] = lo[2];
+	mid[d] = (lo[d]+hi[d])/2;
+	InsertObject(id, mid, hi, cells);
+
+}
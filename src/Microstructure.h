@@ -81,16 +81,53 @@ public:
 	 */
 	triple PeriodicBoundary(triple trialpos);
 
-	void SetBoxSize(double size) {m_boxsize=size;}
+	void SetBoxSize(double size) {m_boxsize=size; m_index_built=false;}
+
+	/**
+	 * build the spatial index now, e.g. before several threads look up objects
+	 */
+	void UpdateIndex() {if (!m_index_built) BuildIndex();};
 	double GetBoxSize() {return m_boxsize;}
 
 protected:
+	/**
+	 * @brief number of objects covered by the spatial index; 0 -> no index
+	 */
+	virtual int NumObjects() {return 0;};
+
+	/**
+	 * @brief may object id reach into the sphere around center? (conservative test)
+	 */
+	virtual bool ObjectNear(int id, const triple &center, double radius) {return true;};
+
+	/**
+	 * @brief objects which may contain pos, in ascending order; the index is built on first use
+	 * returns false, if there is no index for pos (then all objects have to be tested).
+	 */
+	bool Candidates(const triple &pos, const int* &ids, int &n);
+
+	/**
+	 * @brief objects changed: rebuild the index on next use
+	 */
+	void InvalidateIndex() {m_index_built=false;};
+
 	// microstructure is defined in box with [-m_boxsize..m_boxsize] in each direction
 	double m_boxsize;
 	double m_D_external;
 
 	RNG* m_rng;
 
+private:
+	void BuildIndex();
+	void InsertObject(int id, const int* lo, const int* hi, vector< vector<int> > &cells);
+
+	// spatial index: uniform grid of cells over the box, listing the objects reaching into each cell
+	bool        m_index_built;	/**<@brief index is up to date 			*/
+	int         m_index_n;		/**<@brief cells per dimension 			*/
+	double      m_index_h;		/**<@brief cell edge length 			*/
+	vector<int> m_index_first;	/**<@brief first entry of each cell in m_index_ids */
+	vector<int> m_index_ids;	/**<@brief object ids of all cells 		*/
+
 };
 
 #endif /* MICROSTRUCTURE_H_ */
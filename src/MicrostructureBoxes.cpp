@@ -39,6 +39,7 @@ MicrostructureBoxes::~MicrostructureBoxes() {
 /***********************************************************/
 void MicrostructureBoxes::AddBox(box new_box) {
 	m_boxes.push_back(new_box);
+	InvalidateIndex();
 }
 /***********************************************************/
 bool MicrostructureBoxes::IsInsideObjectBox(triple pos, box cur_box){
@@ -49,6 +50,11 @@ bool MicrostructureBoxes::IsInsideObjectBox(triple pos, box cur_box){
 	}
 }
 /***********************************************************/
+bool MicrostructureBoxes::ObjectNear(int id, const triple &center, double radius) {
+	const box &b = m_boxes[id];
+	return ((fabs(center.x-b.x) < b.size_x+radius) && (fabs(center.y-b.y) < b.size_y+radius) && (fabs(center.z-b.z) < b.size_z+radius));
+}
+/***********************************************************/
 double MicrostructureBoxes::GetD(int ObjectID ,int shellid) {
 	if (ObjectID == -1) {return m_D_external;};
 	return m_boxes[ObjectID].D;
@@ -65,8 +71,11 @@ void MicrostructureBoxes::IndexObject(triple pos,int &LastId ,int &shellid) {
 			return;
 		}
 	}
-	// now test all boxes:
-	for (int i=0;i<m_boxes.size();i++){
+	// now test all boxes near pos:
+	const int* ids; int n;
+	if (!Candidates(pos,ids,n)) {ids=NULL; n=m_boxes.size();}
+	for (int k=0;k<n;k++){
+		int i = ids ? ids[k] : k;
 		if (IsInsideObjectBox(pos,m_boxes[i])) {
 			// found right box:
 			LastId = i;
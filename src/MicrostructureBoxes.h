@@ -60,6 +60,9 @@ public:
 	void AddBox(box new_box);
 	virtual double GetD(int LastId=-1,int shellid=-1);
 	virtual void IndexObject(triple pos,int &LastId ,int &shellid);
+protected:
+	virtual int NumObjects() {return m_boxes.size();};
+	virtual bool ObjectNear(int id, const triple &center, double radius);
 private:
 	bool IsInsideObjectBox(triple pos, box cur_box);
 	vector<box> m_boxes;		// container for all boxes inside microstructure
@@ -93,6 +93,7 @@ void MicrostructureSingleFiber::GenerateStructure(){
 		}
 	}
 	cout << "build "<<m_axons.size() << " neurons."<<endl;
+	InvalidateIndex();
 	delete m_rng;
 }
 /***********************************************************/
@@ -152,7 +153,11 @@ void MicrostructureSingleFiber::IndexObject(triple pos,  int &LastID ,int &shell
 		if (dis < m_axons[LastID].r_a) {shellid = 0; return;}
 		if (dis < m_axons[LastID].r_m) {shellid = 1; return;}
 	}
-	for (int i=0; i<m_axons.size(); i++) {
+	// only axons near pos
+	const int* ids; int n;
+	if (!Candidates(pos,ids,n)) {ids=NULL; n=m_axons.size();}
+	for (int k=0; k<n; k++) {
+		int i = ids ? ids[k] : k;
 		dis = GetPointDistance(pos,m_axons[i]);
 		if (dis < m_axons[i].r_a) {shellid = 0; LastID = i; return;}
 		if (dis < m_axons[i].r_m) {shellid = 1; LastID = i; return;}
@@ -96,6 +96,9 @@ protected:
 
 	virtual bool	CylinderCollide(const neuron &test);		/* test if this neuron is overlapping with any other in structure. */
 	double 	GetCylinderVolume(const neuron &test);	/* calculate volume of cylinder in box.  */
+	virtual int NumObjects() {return m_axons.size();};
+	virtual bool ObjectNear(int id, const triple &center, double radius) {return (GetPointDistance(center,m_axons[id]) < m_axons[id].r_m+radius);};
+
 	/**
 	 * @brief Get distance between point pos and cylinder tmp.
 	 */
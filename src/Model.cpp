@@ -84,6 +84,7 @@ void Model::Solve() {
         DynamicVariables*  dynvar = DynamicVariables::instance();
         dynvar->SetActivation();
         dynvar->m_Diffusion->UpdateTrajectory(true);
+        m_world->ResetSpinPosition();
 
         int m_ncoprops =  (m_world->GetNoOfSpinProps () - 4) / m_world->GetNoOfCompartments();
         //start with equilibrium solution
@@ -77,7 +77,7 @@ class Module : public Prototype {
      * cycle and put the values put the values in dAllVal.
      * Successors must implements this method.
      *
-     * @param dAllVal is an array of 5 doubles. {amplitude, phase, Gx, Gy, Gz}
+     * @param dAllVal is an array of 5 doubles. {B1x, B1y, Gx, Gy, Gz}; RF pulses add their field in cartesian form
      *                Gx, Gy, Gz equal to 1.0 for the direction of the Axis. 0.0 else.
      * @param time    constant double value of the time of invocation.
      */
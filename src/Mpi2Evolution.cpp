@@ -31,11 +31,14 @@
 #include "Mpi2Evolution.h"
 #include "World.h"
 #include <cmath>
+#include <algorithm>
 #include "config.h"
 
 // init variables:
 #ifdef HAVE_MPI_THREADS
 vector<MPI_File> 		Mpi2Evolution::m_files;
+vector< vector<double> > Mpi2Evolution::m_records;
+long					Mpi2Evolution::m_buffered = 0;
 #endif
 vector<bool>			Mpi2Evolution::m_first_write;
 
@@ -83,6 +86,9 @@ void Mpi2Evolution::OpenFiles(int is_restart){
 	filesize = (SpinNo * 7 +2)* sizeof(double);
     MPI_Status status;
 
+	m_records.resize(M);
+	m_buffered = 0;
+
 	for (int i=0; i<M; i++) {
         stringstream sF;
         sF << pW->saveEvolFileName << "_" << setw(3) << setfill('0') << i+1 << ".bin";
@@ -116,11 +122,73 @@ void Mpi2Evolution::OpenFiles(int is_restart){
 
 
 /*****************************************************************************/
-void Mpi2Evolution::CloseFiles(){
+void Mpi2Evolution::CloseFiles(bool collective){
 #ifdef HAVE_MPI_THREADS
 	for (unsigned int i=0; i<m_files.size(); i++) {
-		MPI_File_close(&m_files[i]);
+		Flush(i, collective);
+		if (collective)
+			MPI_File_close(&m_files[i]);
 	}
+	m_files.clear();
+	m_records.clear();
+#endif
+}
+
+/*****************************************************************************/
+void Mpi2Evolution::Flush(int n, bool collective){
+#ifdef HAVE_MPI_THREADS
+
+	vector<double>& rec = m_records[n];
+	long nrec = rec.size() / 7;
+
+	// sort records by spin ID
+	vector< pair<double,long> > order (nrec);
+	for (long i=0; i<nrec; i++)
+		order[i] = make_pair(rec[7*i], i);
+	sort (order.begin(), order.end());
+
+	// merge records of consecutive spins into blocks of the file
+	vector<double>   buf;
+	vector<int>      blocklen;
+	vector<MPI_Aint> displ;
+	buf.reserve(rec.size());
+	long last = -2;
+	for (long i=0; i<nrec; i++) {
+		long id = (long) order[i].first;
+		if (id == last) continue; // spin of a lost slave, simulated twice
+		if (id == last+1)
+			blocklen.back() += 7;
+		else {
+			blocklen.push_back(7);
+			displ.push_back((MPI_Aint) ((2+7*id)*sizeof(double)));
+		}
+		buf.insert(buf.end(), &rec[7*order[i].second], &rec[7*order[i].second]+7);
+		last = id;
+	}
+
+	MPI_Status status;
+	if (!collective) {
+		size_t pos = 0;
+		for (unsigned int k=0; k<blocklen.size(); k++) {
+			MPI_File_write_at(m_files[n], (MPI_Offset) displ[k], &buf[pos], blocklen[k], MPI_DOUBLE, &status);
+			pos += blocklen[k];
+		}
+	} else {
+		// all blocks of this process in one file view; processes without records write nothing
+		MPI_Datatype ftype = MPI_DOUBLE;
+		if (!blocklen.empty()) {
+			MPI_Type_create_hindexed((int) blocklen.size(), &blocklen[0], &displ[0], MPI_DOUBLE, &ftype);
+			MPI_Type_commit(&ftype);
+		}
+		MPI_File_set_view(m_files[n], 0, MPI_DOUBLE, ftype, (char*) "native", MPI_INFO_NULL);
+		MPI_File_write_at_all(m_files[n], 0, buf.data(), (int) buf.size(), MPI_DOUBLE, &status);
+		if (!blocklen.empty())
+			MPI_Type_free(&ftype);
+	}
+
+	m_buffered -= nrec;
+	rec.clear();
+
 #endif
 }
 /*****************************************************************************/
@@ -155,9 +223,13 @@ void Mpi2Evolution::saveEvolution(long index, bool close_files) {
 	    tmp[5]=My;
 	    tmp[6]=pW->solution[ZC];
 
-	    MPI_Offset offset = (2+7*pW->Values[ID])*sizeof(double);
+	    // buffer the record; written in blocks of consecutive spins
+	    m_records[n].insert(m_records[n].end(), tmp, tmp+7);
+	    m_buffered++;
 
-        MPI_File_write_at(m_files[n], offset,tmp,7,MPI_DOUBLE,&status);
+	    if (m_buffered >= EVOL_BUFFER_RECORDS)
+	    	for (unsigned int i=0; i<m_records.size(); i++)
+	    		Flush(i, false);
 
 
 	    return;
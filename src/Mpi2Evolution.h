@@ -34,6 +34,11 @@
 #include <vector>
 #include "config.h"
 
+/**
+ * No of evolution records buffered by a process before they are written
+ */
+#define EVOL_BUFFER_RECORDS 262144
+
 using namespace std;
 
 /**
@@ -55,9 +60,10 @@ public:
 	static void OpenFiles(int is_restart);
 
 	/**
-	 * close evolution file(s)
+	 * close evolution file(s) (collective);
+	 * otherwise only write the buffered records, as other processes may not take part
 	 */
-	static void CloseFiles();
+	static void CloseFiles(bool collective = true);
 
 	/**
 	 * write evolution file(s) using parallel I/O
@@ -69,8 +75,16 @@ public:
 	 */
 	static void SetSaveFunction();
 
+	/**
+	 * write the buffered records of an evolution file, sorted by spin ID;
+	 * independent writes of contiguous spin ranges, or one collective write (all processes)
+	 */
+	static void Flush(int n, bool collective);
+
 #ifdef HAVE_MPI_THREADS
 	static vector<MPI_File> 	m_files;
+	static vector< vector<double> > m_records;  /**< buffered records (ID, x, y, z, Mx, My, Mz) of each file */
+	static long					m_buffered;     /**< no of buffered records of all files */
 #endif
 	static vector<bool>			m_first_write;
 
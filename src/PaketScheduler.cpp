@@ -0,0 +1,230 @@
+/** @file PaketScheduler.cpp
+ *  @brief Implementation of JEMRIS PaketScheduler
+ */
+
+/*
+ *  JEMRIS Copyright (C)
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "PaketScheduler.h"
+#include "Declarations.h"
+
+#include <cmath>
+
+static const int F = NO_COST_FEATURES;
+
+/**********************************************************/
+PaketScheduler::PaketScheduler () {
+
+	Init(1, 1, 30.0);
+
+}
+
+/**********************************************************/
+void PaketScheduler::Init (int size, int computing, double interval) {
+
+	m_pending.clear();
+	m_pending.resize(size);
+	m_speed.assign(size, 0.0);
+	m_spins.assign(size, 0.0);
+	m_busy.assign (size, 0.0);
+
+	m_computing = computing;
+	m_interval  = interval;
+	m_spin_cost = 0.0;
+	m_fits      = 0;
+
+	for (int i=0; i<F; i++) {
+		m_remaining[i] = 0.0;
+		m_w[i]         = 0.0;
+		for (int j=0; j<F; j++)
+			m_P[i*F+j] = (i==j) ? 100.0 : 0.0;
+	}
+
+}
+
+/**********************************************************/
+void PaketScheduler::AddFeatures (const double* val, int ncomp, double* phi) {
+
+	phi[0] += 1.0;
+
+	// properties of multi-pool samples are laid out per pool; count spins only
+	if (ncomp > 1)
+		return;
+
+	phi[1] += fabs(val[DB]);
+	phi[2] += val[R2];
+	phi[3] += val[M0];
+
+}
+
+/**********************************************************/
+void PaketScheduler::SetRemaining (const double* phi) {
+
+	for (int i=0; i<F; i++)
+		m_remaining[i] = phi[i];
+
+}
+
+/**********************************************************/
+void PaketScheduler::Sent (int id, const double* phi, int n) {
+
+	Paket p;
+	p.n = n;
+	for (int i=0; i<F; i++) {
+		p.phi[i]        = phi[i];
+		m_remaining[i] -= phi[i];
+	}
+	m_pending[id].push_back(p);
+
+}
+
+/**********************************************************/
+void PaketScheduler::Lost (int id, const double* phi) {
+
+	m_pending[id].clear();
+	m_speed[id] = 0.0;
+	m_spins[id] = 0.0;
+	m_busy[id]  = 0.0;
+	m_computing--;
+
+	for (int i=0; i<F; i++)
+		m_remaining[i] += phi[i];
+
+}
+
+/**********************************************************/
+void PaketScheduler::Requested (int id, double elapsed, int depth) {
+
+	// the slave still holds the pakets sent after the one it finished
+	if ((int) m_pending[id].size() <= depth)
+		return;
+
+	Paket p = m_pending[id].front();
+	m_pending[id].pop_front();
+
+	if (p.n == 0 || elapsed <= 0.0)
+		return;
+
+	// time and features per spin
+	double y = elapsed / p.n;
+	double x[F];
+	for (int i=0; i<F; i++)
+		x[i] = p.phi[i] / p.n;
+
+	// fit the model to the time of an average slave; the speed is measured
+	// on the previous pakets, as this paket's own cost would cancel out
+	y           *= Speed(id);
+	m_spin_cost  = Ready() ? 0.7*m_spin_cost + 0.3*y : y;
+	Fit(x, y);
+
+	// measured throughput of this slave, independent of the cost model: averaged over
+	// many pakets (slowly forgetting), as the cost of single pakets differs a lot
+	m_spins[id]  = 0.99*m_spins[id] + p.n;
+	m_busy[id]   = 0.99*m_busy[id]  + elapsed;
+	m_speed[id]  = m_spins[id] / m_busy[id];
+
+}
+
+/**********************************************************/
+double PaketScheduler::Speed (int id) const {
+
+	if (m_speed[id] <= 0.0)
+		return 1.0;
+
+	double mean  = 0.0;
+	int    known = 0;
+	for (unsigned int i=0; i<m_speed.size(); i++)
+		if (m_speed[i] > 0.0) {
+			mean += m_speed[i];
+			known++;
+		}
+
+	return m_speed[id] * known / mean;
+
+}
+
+/**********************************************************/
+double PaketScheduler::SpinCost (const double* phi) const {
+
+	double mean = phi[0] * m_spin_cost;
+
+	// model not yet determined: mean time per spin
+	if (m_fits < 2*F)
+		return mean;
+
+	double c = 0.0;
+	for (int i=0; i<F; i++)
+		c += m_w[i] * phi[i];
+
+	// keep predictions within a sane range of the mean
+	if (c < 0.1*mean) c = 0.1*mean;
+	if (c > 10.*mean) c = 10.*mean;
+
+	return c;
+
+}
+
+/**********************************************************/
+double PaketScheduler::Budget (int id) const {
+
+	// total throughput relative to an average slave; slaves without measurement count as average
+	double total = (m_computing > 0) ? m_computing : 1.0;
+
+	// guided self-scheduling: half of the remaining time, at most the sent interval
+	double t = 0.5 * SpinCost(m_remaining) / total;
+	if (t > m_interval) t = m_interval;
+
+	return t * Speed(id);
+
+}
+
+/**********************************************************/
+void PaketScheduler::Fit (const double* x, double y) {
+
+	const double lambda = 0.9; // forgetting factor
+
+	double Px[F];
+	double xPx = 0.0;
+	for (int i=0; i<F; i++) {
+		Px[i] = 0.0;
+		for (int j=0; j<F; j++)
+			Px[i] += m_P[i*F+j] * x[j];
+		xPx += x[i] * Px[i];
+	}
+
+	double e = y;
+	for (int i=0; i<F; i++)
+		e -= m_w[i] * x[i];
+
+	double g[F];
+	for (int i=0; i<F; i++) {
+		g[i]    = Px[i] / (lambda + xPx);
+		m_w[i] += g[i] * e;
+	}
+
+	for (int i=0; i<F; i++)
+		for (int j=0; j<F; j++)
+			m_P[i*F+j] = (m_P[i*F+j] - g[i]*Px[j]) / lambda;
+
+	m_fits++;
+
+}
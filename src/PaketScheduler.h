@@ -0,0 +1,170 @@
+/** @file PaketScheduler.h
+ *  @brief Implementation of JEMRIS PaketScheduler
+ */
+
+/*
+ *  JEMRIS Copyright (C)
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef PAKETSCHEDULER_H_
+#define PAKETSCHEDULER_H_
+
+#include <vector>
+#include <deque>
+
+using namespace std;
+
+/**
+ * Number of spin features of the cost model: 1, |DB|, R2, M0
+ */
+#define NO_COST_FEATURES 4
+
+/**
+ * @brief Sizes the spin pakets of parallel jemris
+ *
+ * The simulation time of a spin is predicted by a linear model of its properties,
+ * fitted by recursive least squares to the measured time per spin of the pakets.
+ * Each slave has a measured throughput (spins per second, averaged over its
+ * pakets). Relative to the mean of all slaves, it normalises the fitted times and
+ * sizes the pakets, so slower slaves get smaller pakets. Pakets last about the
+ * sent interval, but shrink towards the end of the simulation (guided
+ * self-scheduling), such that all slaves finish at about the same time.
+ */
+class PaketScheduler {
+
+ public:
+
+	/**
+	 * @brief Constructor
+	 */
+	PaketScheduler ();
+
+	/**
+	 * @brief Destructor
+	 */
+	~PaketScheduler () {};
+
+	/**
+	 * @brief Initialise
+	 *
+	 * @param size      Number of processes (master included)
+	 * @param computing Number of processes which simulate spins
+	 * @param interval  Time in seconds a paket should approx. take
+	 */
+	void   Init (int size, int computing, double interval);
+
+	/**
+	 * @brief Add the features of a spin
+	 *
+	 * @param val  Spin properties
+	 * @param ncomp Number of spin compartments
+	 * @param phi  Feature sum to add to
+	 */
+	static void AddFeatures (const double* val, int ncomp, double* phi);
+
+	/**
+	 * @brief Set the feature sum of all spins still to be sent
+	 */
+	void   SetRemaining (const double* phi);
+
+	/**
+	 * @brief A paket was sent to a slave
+	 *
+	 * @param id   Slave
+	 * @param phi  Feature sum of the paket
+	 * @param n    Number of spins in the paket
+	 */
+	void   Sent (int id, const double* phi, int n);
+
+	/**
+	 * @brief A slave requested its next paket; measure the paket it finished
+	 *
+	 * @param id      Slave
+	 * @param elapsed Time since its previous request [s]
+	 * @param depth   Number of pakets the slave holds besides the one it simulates
+	 */
+	void   Requested (int id, double elapsed, int depth);
+
+	/**
+	 * @brief A slave was lost; its unmeasured pakets have to be sent again
+	 *
+	 * @param id   Slave
+	 * @param phi  Feature sum of the lost pakets
+	 */
+	void   Lost (int id, const double* phi);
+
+	/**
+	 * @brief Measurements available?
+	 */
+	bool   Ready () const { return m_spin_cost > 0.0; };
+
+	/**
+	 * @brief Predicted simulation time of a spin on an average slave [s]
+	 *
+	 * @param phi Features of the spin
+	 */
+	double SpinCost (const double* phi) const;
+
+	/**
+	 * @brief Throughput of a slave relative to the mean of the measured slaves (1: unknown)
+	 *
+	 * @param id Slave
+	 */
+	double Speed (int id) const;
+
+	/**
+	 * @brief Predicted time budget of the next paket of a slave,
+	 *        in simulation time on an average slave [s]
+	 *
+	 * @param id Slave
+	 */
+	double Budget (int id) const;
+
+ private:
+
+	/**
+	 * @brief Paket whose simulation time is not yet measured
+	 */
+	struct Paket {
+		int    n;                          /**< Number of spins  */
+		double phi[NO_COST_FEATURES];      /**< Feature sum      */
+	};
+
+	/**
+	 * @brief Recursive least squares update of the cost model
+	 */
+	void   Fit (const double* x, double y);
+
+	vector< deque<Paket> > m_pending;      /**< Sent pakets per slave, not yet measured      */
+	vector<double>         m_speed;        /**< Measured throughput of each slave [spins/s] (0: unknown) */
+	vector<double>         m_spins;        /**< Spins simulated by each slave (decaying sum)  */
+	vector<double>         m_busy;         /**< Time spent by each slave (decaying sum) [s]   */
+	double                 m_remaining[NO_COST_FEATURES]; /**< Feature sum of spins still to be sent */
+	double                 m_w[NO_COST_FEATURES];         /**< Model weights                  */
+	double                 m_P[NO_COST_FEATURES*NO_COST_FEATURES]; /**< Inverse correlation matrix */
+	int                    m_fits;         /**< Number of model updates                     */
+	double                 m_spin_cost;    /**< Mean simulation time per spin (0: unknown)   */
+	double                 m_interval;     /**< Time a paket should approx. take            */
+	int                    m_computing;    /**< Number of processes which simulate spins     */
+
+};
+
+#endif /*PAKETSCHEDULER_H_*/
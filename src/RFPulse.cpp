@@ -160,38 +160,59 @@ void RFPulse::GetValue (double * dAllVal, double const time)  {
     if (time < 0.0 || time > GetDuration())
         return;
 
-	// Get Magnitude and Phase from the B1 sensitivity map
-	double magn  = 1.0;
-	double phase = 0.0;
+	// Get the complex B1 sensitivity of my channel
+	double w[2] = {1.0, 0.0};
 
 	if (m_coil_array != NULL) {
 
 		Coil* coil=m_coil_array->GetCoil(m_channel);
 
 		if (coil != NULL) {
-			magn  = coil->GetSensitivity(World::instance()->total_time + time);
-			phase = coil->GetPhase(World::instance()->total_time + time);
+			double magn, phase;
+			coil->GetB1(World::instance()->total_time + time, magn, phase);
+			w[0] = magn*cos(phase);
+			w[1] = magn*sin(phase);
 		} else
 			cout << GetName() << " warning: my channel" << m_channel << "is not in the TxCoilArray\n";
 
 	}
 
+	AddB1(dAllVal, time, w);
+
+}
+
+/*****************************************************************/
+void RFPulse::GetValueAllChannels (double * dAllVal, double const time)  {
+
+    if (time < 0.0 || time > GetDuration())
+        return;
+
+	double w[2];
+	m_coil_array->GetB1(World::instance()->total_time + time, w);
+
+	AddB1(dAllVal, time, w);
+
+}
+
+/*****************************************************************/
+void RFPulse::AddB1 (double * dAllVal, double const time, const double* w)  {
+
 	// Get Magnitude and Phase of this RF pulse
-	magn  *= GetMagnitude(time);
-	phase += GetInitialPhase()*PI/180.0;
+	double magn  = GetMagnitude(time);
+	double phase = GetInitialPhase()*PI/180.0;
 
 	for (unsigned int i=0; i<m_GetPhaseFunPtrs.size(); ++i)
 		phase += m_GetPhaseFunPtrs[i](this,time)*PI/180.0;
 
-	phase = fmod( phase, 2*PI );
-	World::instance()->PhaseLock = (phase<0.0?phase+2*PI:phase);
-
-	//add RFPulse to the B1 field
-	double B1x =  (dAllVal[0]*cos(dAllVal[1]) + magn*cos(phase));
-	double B1y =  (dAllVal[0]*sin(dAllVal[1]) + magn*sin(phase));
+	// ADC phase lock includes the phase of the Tx coil(s)
+	double lock = fmod( phase + atan2(w[1],w[0]), 2*PI );
+	World::instance()->PhaseLock = (lock<0.0?lock+2*PI:lock);
 
-	dAllVal[0] = sqrt(pow(B1x,2.0) + pow(B1y,2.0));
-	dAllVal[1] = atan2(B1y,B1x);
+	//add RFPulse times sensitivity to the B1 field (cartesian)
+	double c = magn*cos(phase);
+	double s = magn*sin(phase);
+	dAllVal[RF_X] += c*w[0] - s*w[1];
+	dAllVal[RF_Y] += c*w[1] + s*w[0];
 
 }
 
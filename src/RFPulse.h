@@ -65,6 +65,18 @@ class RFPulse : public Pulse {
      */
     virtual void GetValue (double * dAllVal, double const time)  ;
 
+    /**
+     * @brief Add the B1 field of this pulse, transmitted with the same waveform
+     *        on every channel of its coil array (parallel transmit)
+     *
+     * The waveform is evaluated once and multiplied by the complex sum of the
+     * coil sensitivities.
+     *
+     * @param dAllVal Sequence values, see Module::GetValue()
+     * @param time    Time point within the pulse
+     */
+    void         GetValueAllChannels (double * dAllVal, double const time)  ;
+
     /**
      * @brief see Module::Prepare()
      */
@@ -184,6 +196,11 @@ class RFPulse : public Pulse {
 
     vector<double (*)(Module*, double)> m_GetPhaseFunPtrs;   /**< @brief GetPhase functions, adding additional Transmit phase terms*/
 
+    /**
+     * @brief Add the B1 field of this pulse, weighted by a complex coil sensitivity, to dAllVal
+     */
+    void         AddB1 (double * dAllVal, double const time, const double* w);
+
 };
 
 #endif
@@ -29,6 +29,7 @@
 #include "SampleReorderStrategyInterface.h"
 #include "SampleReorderShuffle.h"
 #include "CoilArray.h"
+#include "Coil.h"
 #include "BinaryContext.h"
 
 #include <math.h>
@@ -49,6 +50,8 @@ void Sample::Prepare (const std::string& fname) {
 
     m_r2prime              = 0.0;
     m_pos_rand_perc        = 1.0;
+    m_isochromats          = 1;
+    m_iso_seeded           = false;
 	
     for (int i=0;i<3;++i) { 
 		m_res[i]           = 0.0; 
@@ -61,9 +64,9 @@ void Sample::Prepare (const std::string& fname) {
     m_min_paket_size       = 10;
     m_next_spin_to_send    = 0;
     m_is_restart           = false;
+    m_checkpoint           = NULL;
     m_sent_interval        = 30;
-	m_no_spins_done        = 0;
-	m_total_cpu_time       = 0.0;
+    m_master_computes      = false;
 
 	// Standard sample has only one compartment
 	m_no_spin_compartments = 1;
@@ -114,6 +117,9 @@ Sample::~Sample() {
 	if (m_reorder_strategy != NULL)
 		delete m_reorder_strategy;
 
+	if (m_checkpoint != NULL)
+		delete m_checkpoint;
+
 }
 
 
@@ -314,19 +320,69 @@ if (multiple>1){
 }
 
 
+}
+
+/**********************************************************/
+void Sample::SetIsochromats (int n) {
+
+	if (n < 1)
+		n = 1;
+
+	m_isochromats = n;
+	m_iso_seeded  = (n > 1);
+
+	// bookkeeping for restart is done per isochromat
+	m_spin_state.clear();
+	m_spin_state.resize(GetSize(),0);
+
+}
+
+/**********************************************************/
+void Sample::SeedIsochromat (const size_t id) {
+
+	// counter-based key: the same spin gets the same numbers on any process
+	m_rng.init(World::instance()->m_seed, id, RNG_ISOCHROMAT);
+
 }
 
 /**********************************************************/
 size_t  Sample::GetSize   ()     const  {
-	return m_ensemble.NSpins();
+	return m_ensemble.NSpins() * m_isochromats;
+}
+
+/**********************************************************/
+double* Sample::GetSpinsData (const size_t beg, const size_t n) {
+
+	size_t nprops = m_ensemble.NProps();
+
+	if (m_isochromats == 1 && !IsProcedural())
+		return m_ensemble.Data() + beg*nprops;
+
+	// expand voxels; randomisation is done by the receiver (seeded with the ID)
+	m_packet.resize(n*nprops);
+
+	for (size_t i = 0; i < n; i++) {
+		CopyVoxel ((beg+i)/m_isochromats, &m_packet[i*nprops]);
+		m_packet[i*nprops + nprops - 1] = beg + i;
+	}
+
+	return m_packet.data();
+
 }
 
 /**********************************************************/
 void Sample::GetValues (const size_t l, double* val) {
 
-	//copy the properties of the l-th spin to m_val
+	size_t nprops = m_ensemble.NProps();
 
-	memcpy (val, &m_ensemble[l*m_ensemble.NProps()], m_ensemble.NProps() * sizeof (double));
+	//copy the properties of the l-th spin to m_val (l-th isochromat of voxel l/m_isochromats)
+	CopyVoxel (l/m_isochromats, val);
+	if (m_isochromats > 1)
+		val[nprops-1] = l;
+
+	//reproducible sub-voxel position and off-resonance (drawn in GetDeltaB)
+	if (m_iso_seeded)
+		SeedIsochromat ((size_t) val[nprops-1]);
 
 	//add position randomness of spin position
 	val[XC] += m_rng.normal()*m_res[XC]*m_pos_rand_perc/100.0;
@@ -335,6 +391,25 @@ void Sample::GetValues (const size_t l, double* val) {
 
 }
 
+/**********************************************************/
+void Sample::GetVoxelPosition (const size_t n, double* position) {
+
+	vector<double> val (m_ensemble.NProps());
+	CopyVoxel (n, &val[0]);
+
+	position[XC] = val[XC];
+	position[YC] = val[YC];
+	position[ZC] = val[ZC];
+
+}
+
+/**********************************************************/
+void Sample::CopyVoxel (const size_t n, double* val) {
+
+	memcpy (val, &m_ensemble[n*m_ensemble.NProps()], m_ensemble.NProps() * sizeof (double));
+
+}
+
 /**********************************************************/
 double  Sample::GetDeltaB (size_t pos) {
 
@@ -368,6 +443,9 @@ void  Sample::GetScatterVectors(int *sendcount, int *displs, int size) {
 	World* pw = World::instance();
 	m_spins_sent.resize(size);
 	m_last_offset_sent.resize(size);
+	m_in_flight.clear();
+	m_in_flight.resize(size);
+	m_requeued.clear();
 
 	timeval dummy;
 	gettimeofday(&dummy,NULL);
@@ -375,23 +453,24 @@ void  Sample::GetScatterVectors(int *sendcount, int *displs, int size) {
 	if (!m_is_restart) {
 		if (!(pw->m_useLoadBalancing)) {
 			// send all at once:
-			int count = (int) (( (double) GetSize() ) / ((double) (size - 1) ) + 0.01);
-			int rest  = (int) (fmod((double) GetSize() , (double) (size - 1) ) + 0.01);
+			int count = (int) (( (double) GetSize() ) / ((double) NoComputing() ) + 0.01);
+			int rest  = (int) (fmod((double) GetSize() , (double) NoComputing() ) + 0.01);
 			
-			// no spin data for master:
+			// no spin data for master, unless it simulates too:
 			displs[0]	= 0;
 			sendcount[0]= 0;
 			
-			for (int i=1;i<size;i++) {
+			for (int i=(m_master_computes ? 0 : 1);i<size;i++) {
 				sendcount[i] 	= count;
 				if (rest > 0) {
 					sendcount[i]++;
 					rest--;
 				}
-				displs[i]=displs[i-1]+sendcount[i-1];
+				if (i > 0) displs[i]=displs[i-1]+sendcount[i-1];
 				// bookkeeping
 				m_spins_sent[i]=sendcount[i];
 				m_last_offset_sent[i]=displs[i];
+				m_in_flight[i].push_back(make_pair(displs[i],sendcount[i]));
 				if (sendcount[i]>0)
 					ReportSpin(displs[i],displs[i]+sendcount[i]-1,1);
 			}
@@ -402,8 +481,17 @@ void  Sample::GetScatterVectors(int *sendcount, int *displs, int size) {
 		}
 	}
 	// now get scatter in case of restart/loadbalancing:
+	m_scheduler.Init(size, NoComputing(), m_sent_interval);
+	double phi[NO_COST_FEATURES] = {0.0};
+
 	displs[0]	= 0;
 	sendcount[0]= 0;
+	m_spins_sent[0] = 0;
+	m_last_offset_sent[0] = 0;
+	if (m_master_computes) {
+		m_in_flight[0].push_back(make_pair(0,0));
+		m_scheduler.Sent(0,phi,0);
+	}
 
 	int spins_left = pw->TotalSpinNumber;
 
@@ -443,6 +531,12 @@ void  Sample::GetScatterVectors(int *sendcount, int *displs, int size) {
 		// bookkeeping
 		m_spins_sent[i]=sendcount[i];
 		m_last_offset_sent[i]=displs[i];
+		m_in_flight[i].push_back(make_pair(displs[i],sendcount[i]));
+
+		for (int k=0; k<NO_COST_FEATURES; k++) phi[k] = 0.0;
+		for (int l=displs[i]; l<displs[i]+sendcount[i]; l++)
+			AddCostFeatures(l,phi);
+		m_scheduler.Sent(i,phi,sendcount[i]);
 
 		if (sendcount[i]>0)
 			ReportSpin(displs[i],displs[i]+sendcount[i]-1,1);
@@ -451,6 +545,13 @@ void  Sample::GetScatterVectors(int *sendcount, int *displs, int size) {
 	m_last_time.resize(size,dummy);
 	m_next_spin_to_send = displs[size-1] + sendcount[size-1];
 
+	// features of the spins still to be sent
+	for (int k=0; k<NO_COST_FEATURES; k++) phi[k] = 0.0;
+	for (size_t l=0; l<GetSize(); l++)
+		if (m_spin_state[l] == 0)
+			AddCostFeatures(l,phi);
+	m_scheduler.SetRemaining(phi);
+
 	return;
 }
 
@@ -461,14 +562,25 @@ void Sample::GetNextPacket(int &NoSpins, int &NextSpinToSend, int ID) {
 	gettimeofday(&dummy,NULL);
 	double time_used;
 	time_used=((double) dummy.tv_sec - m_last_time[ID].tv_sec) + 0.000001*((double) dummy.tv_usec - (double) m_last_time[ID].tv_usec);
-	m_total_cpu_time += time_used;
 	m_last_time[ID] = dummy;
-	m_no_spins_done += m_spins_sent[ID];
 
-	//bookkeeping:
-	if (m_spins_sent[ID] > 0)
-		ReportSpin(m_last_offset_sent[ID],m_last_offset_sent[ID]+m_spins_sent[ID]-1,2);
+	// slaves prefetch one paket ahead, the computing master does not
+	m_scheduler.Requested(ID, time_used, (ID == 0 && m_master_computes) ? 0 : 1);
+
+	// pakets of lost slaves are sent again first
+	if (!m_requeued.empty()) {
+		pair<int,int> paket = m_requeued.front();
+		m_requeued.pop_front();
+		int maxNoSpins = (paket.second < m_max_paket_size) ? paket.second : m_max_paket_size;
+		NextSpinToSend = paket.first;
+		NoSpins = PaketSize(NextSpinToSend, maxNoSpins, ID);
+		if (NoSpins < paket.second)
+			m_requeued.push_front(make_pair(paket.first+NoSpins, paket.second-NoSpins));
+		PaketSent(NoSpins, NextSpinToSend, ID);
+		return;
+	}
 
+	// spins are marked as calculated by PaketDone, when their signal is received
 	// spins left to send?
 	if (m_next_spin_to_send < GetSize()) {
 		while (m_spin_state[m_next_spin_to_send] != 0) {
@@ -481,41 +593,114 @@ void Sample::GetNextPacket(int &NoSpins, int &NextSpinToSend, int ID) {
 		NoSpins = 0;
 		NextSpinToSend=-1;
 		return;
-	} else {
-		int spinsleft;
-		if (!m_is_restart) {	spinsleft = GetSize() - m_next_spin_to_send;} else {spinsleft=SpinsLeft();}
-		if (m_no_spins_done == 0) {NoSpins = m_min_paket_size;} else {
-			World* pw=World::instance();
-			NoSpins = int ( (m_no_spins_done / m_total_cpu_time) * m_sent_interval * (pw->m_no_processes - 1));
-			// make sample size partly random to avoid syncronisation of slaves:
-			NoSpins += (m_rng.uniform()-0.5)*0.1*NoSpins;
-			//decrease NoSpins towards end of simulation:
-			int EndNoSpins = floor(((double) spinsleft)/2.0/((double) m_last_time.size()-1));
-			if (NoSpins > EndNoSpins) NoSpins = EndNoSpins;
-		}
-		if (NoSpins > m_max_paket_size) NoSpins = m_max_paket_size;
-		if (NoSpins < m_min_paket_size)	NoSpins = m_min_paket_size;
-		if (NoSpins > spinsleft) NoSpins = spinsleft;
-		if (m_is_restart) {
-			int count;
-			for (count=1;count<=NoSpins;count++) {
-				if (m_spin_state[m_next_spin_to_send+count]!=0) {
-					count ++;
-					break;
-				}
-			}
-			count--;
-			NoSpins = count;
-		}
-		NextSpinToSend=m_next_spin_to_send;
-		m_next_spin_to_send += NoSpins;
-
-		// bookkeeping:
-		m_last_offset_sent[ID] = NextSpinToSend;
-		m_spins_sent[ID] = NoSpins;
-		if (NoSpins > 0)
-			ReportSpin(m_last_offset_sent[ID],m_last_offset_sent[ID]+m_spins_sent[ID]-1,1);
 	}
+
+	int spinsleft;
+	if (!m_is_restart) {	spinsleft = GetSize() - m_next_spin_to_send;} else {spinsleft=SpinsLeft();}
+	int maxNoSpins = (spinsleft < m_max_paket_size) ? spinsleft : m_max_paket_size;
+
+	NextSpinToSend = m_next_spin_to_send;
+	NoSpins = PaketSize(NextSpinToSend, maxNoSpins, ID);
+	m_next_spin_to_send += NoSpins;
+
+	PaketSent(NoSpins, NextSpinToSend, ID);
+
+}
+
+/**********************************************************/
+int Sample::PaketSize(int first, int maxNoSpins, int ID) {
+
+	// predicted time budget of this slave;
+	// make it partly random to avoid syncronisation of slaves:
+	bool   ready  = m_scheduler.Ready();
+	double budget = ready ? m_scheduler.Budget(ID) : 0.0;
+	budget += (m_rng.uniform()-0.5)*0.1*budget;
+
+	// fill the paket with spins until their predicted cost exceeds the budget
+	double phi[NO_COST_FEATURES] = {0.0};
+	double cost = 0.0;
+	int    NoSpins = 0;
+	while (NoSpins < maxNoSpins) {
+		if (m_is_restart && m_spin_state[first+NoSpins] != 0)
+			break;
+		if (NoSpins >= m_min_paket_size && (!ready || cost >= budget))
+			break;
+		double spin[NO_COST_FEATURES] = {0.0};
+		AddCostFeatures(first+NoSpins, spin);
+		cost += m_scheduler.SpinCost(spin);
+		for (int k=0; k<NO_COST_FEATURES; k++) phi[k] += spin[k];
+		NoSpins++;
+	}
+	m_scheduler.Sent(ID, phi, NoSpins);
+
+	return NoSpins;
+
+}
+
+/**********************************************************/
+void Sample::PaketSent(int NoSpins, int NextSpinToSend, int ID) {
+
+	m_last_offset_sent[ID] = NextSpinToSend;
+	m_spins_sent[ID] = NoSpins;
+	if (NoSpins > 0) {
+		ReportSpin(m_last_offset_sent[ID],m_last_offset_sent[ID]+m_spins_sent[ID]-1,1);
+		m_in_flight[ID].push_back(make_pair(NextSpinToSend,NoSpins));
+	}
+
+}
+
+/**********************************************************/
+void Sample::WorkerLost(int ID) {
+
+	// the signal of all pakets since the last checkpoint of the slave is lost
+	double phi[NO_COST_FEATURES] = {0.0};
+	int    lost = 0;
+	while (!m_in_flight[ID].empty()) {
+		pair<int,int> paket = m_in_flight[ID].front();
+		m_in_flight[ID].pop_front();
+		if (paket.second == 0)
+			continue;
+		ReportSpin(paket.first,paket.first+paket.second-1,0);
+		for (int l=paket.first; l<paket.first+paket.second; l++)
+			AddCostFeatures(l,phi);
+		m_requeued.push_back(paket);
+		lost += paket.second;
+	}
+	m_spins_sent[ID] = 0;
+	m_scheduler.Lost(ID, phi);
+
+	cout << endl << "slave " << ID << " lost: " << lost << " spins are simulated again" << endl;
+
+}
+
+/**********************************************************/
+void Sample::AddCostFeatures(const size_t l, double* phi) {
+
+	m_cost_val.resize(GetNProps());
+	CopyVoxel(l/m_isochromats, &m_cost_val[0]);
+	PaketScheduler::AddFeatures(&m_cost_val[0], m_no_spin_compartments, phi);
+
+}
+
+/**********************************************************/
+int Sample::NoComputing() {
+
+	return World::instance()->m_no_processes - (m_master_computes ? 0 : 1);
+
+}
+
+/**********************************************************/
+void Sample::PaketDone(int ID) {
+
+	if (m_in_flight[ID].empty())
+		return;
+
+	pair<int,int> paket = m_in_flight[ID].front();
+	m_in_flight[ID].pop_front();
+
+	if (paket.second > 0)
+		ReportSpin(paket.first,paket.first+paket.second-1,2);
+
 }
 
 /**********************************************************/
@@ -524,29 +709,30 @@ void Sample::DumpRestartInfo(CoilArray* RxCA) {
 
 	// wait at least 10 seconds to dump restart info again. (-> in parallel jemris and syncron slaves prevent excessive disk writing...)
 	if (abs(time(NULL) - lasttime) > 10) {
-		lasttime = time(NULL);
-		RxCA->DumpSignals(".tmp_sig", false);
-		string fname(".spins_state.dat");
-		ofstream fout(fname.c_str() , ios::binary);
-		fout.write(&m_spin_state.at(0), sizeof(char)*m_spin_state.size());
-		fout.close();
+		if (m_checkpoint == NULL)
+			m_checkpoint = new Checkpoint();
+		// snapshot only; skipped while the previous one is still being written
+		if (m_checkpoint->Save(RxCA, m_spin_state))
+			lasttime = time(NULL);
 	}
 }
 
 /**********************************************************/
-int Sample::ReadSpinsState() {
+void Sample::DeleteRestartInfo() {
 
-	ifstream spinsFile(".spins_state.dat", ifstream::binary);
+	if (m_checkpoint != NULL) {
+		delete m_checkpoint;
+		m_checkpoint = NULL;
+	}
+	Checkpoint::Remove();
 
-	if (!spinsFile.is_open()) return (-2);
-	// get length of file:
-	spinsFile.seekg (0, ios::end);
-	unsigned int length = spinsFile.tellg();
-	if (length != m_spin_state.size()) {spinsFile.close();  return (-1);}
-	spinsFile.seekg (0, ios::beg);
-	spinsFile.read (&m_spin_state.at(0),length);
-	spinsFile.close();
+}
+
+/**********************************************************/
+int Sample::ReadSpinsState(CoilArray* RxCA) {
 
+	int status = Checkpoint::Load(RxCA, m_spin_state);
+	if (status != 0) return status;
 
 	World* pw = World::instance();
 	int start=0;
@@ -560,6 +746,8 @@ int Sample::ReadSpinsState() {
 		for (int i=start; i < GetSize(); i++) {
 			if (m_spin_state[i] == 2) {
 				ClearSpinsState();
+				for (unsigned int c=0; c<RxCA->GetSize(); c++)
+					RxCA->GetCoil(c)->GetSignal()->Repo()->Clear();
 				return -1;
 			}
 		}
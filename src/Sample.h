@@ -32,9 +32,12 @@
 #include <fstream>
 #include <cstdlib>
 #include <iostream>
+#include <deque>
 #include <xercesc/dom/DOM.hpp>
 #include "rng.h"
 #include "Declarations.h"
+#include "PaketScheduler.h"
+#include "Checkpoint.h"
 #include "sys/time.h"
 
 class SampleReorderStrategyInterface;
@@ -437,6 +440,40 @@ class Sample {
      */
     void    SetPositionRandomness   (double val) {m_pos_rand_perc = val;};
 
+    /**
+     * @brief Set the number of isochromats generated on the fly from every voxel.
+     *
+     * Unlike MultiplySample, the sample is not cloned in memory. Isochromat l is
+     * expanded from voxel l/n by GetValues. Its sub-voxel position and off-resonance
+     * are drawn from a generator seeded with the isochromat ID, so they are
+     * reproducible independent of the rank or packet which simulates it.
+     *
+     * @param n Number of isochromats per voxel.
+     */
+    void    SetIsochromats   (int n);
+
+    /**
+     * @brief Get the number of isochromats per voxel.
+     *
+     * @return Number of isochromats per voxel.
+     */
+    int     GetIsochromats   () {return m_isochromats;};
+
+    /**
+     * @brief Get the position of a stored voxel (without position randomness).
+     *
+     * @param n        Voxel index, smaller than GetSize()/GetIsochromats().
+     * @param position Position (x,y,z) of the voxel.
+     */
+    void    GetVoxelPosition (const size_t n, double* position);
+
+    /**
+     * @brief Seed the random spin properties with the spin ID (MPI slaves receive expanded isochromats).
+     *
+     * @param val If true, GetValues and GetDeltaB draw from a generator seeded with the spin ID.
+     */
+    void    SetIsochromatSeeding (bool val) {m_iso_seeded = val;};
+
     /**
      * @brief Get off-resonance of a specific spin.
      *
@@ -461,6 +498,29 @@ class Sample {
      */
     double* GetSpinsData() {return m_ensemble.Data();};
 
+    /**
+     * @brief Get data of n consecutive spins starting at spin beg (needed for MPI send)
+     *
+     * With isochromats per voxel or procedural samples, the spins are expanded into a packet buffer.
+     *
+     * @param beg First spin
+     * @param n   Number of spins
+     * @return    Pointer to the spin data
+     */
+    double* GetSpinsData (const size_t beg, const size_t n);
+
+    /**
+     * @brief True, if spin properties are generated on request instead of being stored.
+     *
+     * MPI slaves then generate their spin pakets themselves.
+     */
+    virtual bool IsProcedural () const {return false;};
+
+    /**
+     * @brief Release the packet buffer of expanded isochromats
+     */
+    void    ClearSpinsPacket () {vector<double>().swap(m_packet);};
+
     /**
      * can set a method to reorder the sample (do nothing, shuffle sample,... )
      */
@@ -473,10 +533,16 @@ class Sample {
 
     /**
      * @brief Utility function for restart:
-     * dump information to restart jemris after crash
+     * dump information to restart jemris after crash (written in the background)
      */
     void DumpRestartInfo(CoilArray* RxCA);
 
+    /**
+     * @brief Utility function for restart:
+     * finish writing and delete the restart information
+     */
+    void DeleteRestartInfo();
+
     /**
      * @brief Utility function for restart:
      * mark spins which have been calculated.
@@ -486,8 +552,11 @@ class Sample {
     /**
      * @brief Utility function for restart:
      * Read restart file after crash
+     *
+     * @param RxCA Receive coil array, gets the signals of the restart file
+     * @return     0: success, -1: restart file does not fit, -2: no restart file
      */
-    int ReadSpinsState();
+    int ReadSpinsState(CoilArray* RxCA);
 
     /**
      * @brief Utility function for restart:
@@ -507,6 +576,34 @@ class Sample {
      */
     void GetNextPacket(int &noSpins, int &NextSpinToSend, int SlaveId);
 
+    /**
+     * @brief utility function to send sample in parallel mode:
+     * the initial packet of a slave (as returned by GetScatterVectors).
+     */
+    void GetScatterPacket(int &noSpins, int &NextSpinToSend, int SlaveId) {noSpins=m_spins_sent[SlaveId]; NextSpinToSend=m_last_offset_sent[SlaveId];};
+
+    /**
+     * @brief In parallel mode, the master process simulates spins too (as slave 0).
+     */
+    void    SetMasterComputes(bool val) {m_master_computes=val;};
+
+    /**
+     * @brief utility function to send sample in parallel mode:
+     * the signal of the oldest paket sent to a slave has been received with a restart checkpoint; mark its spins as calculated.
+     */
+    void PaketDone(int SlaveId);
+
+    /**
+     * @brief utility function to send sample in parallel mode:
+     * a slave was lost; its pakets whose signal was not received are sent again.
+     */
+    void WorkerLost(int SlaveId);
+
+    /**
+     * @brief Maximal number of spins in a paket
+     */
+    int GetMaxPaketSize() {return m_max_paket_size;};
+
     /**
      * @brief Returns No spins which still needs to be calculated.
      */
@@ -517,6 +614,11 @@ class Sample {
      */
     void    SetTimeInterval(double val) {m_sent_interval=val;};
 
+    /**
+     * @brief Get Time interval in seconds after which new spins are sent (approx. value.)
+     */
+    double  GetTimeInterval() {return m_sent_interval;};
+
     /**
      * @brief true if simulation run is from a restart
      */
@@ -545,6 +647,18 @@ class Sample {
  protected:
 	void 	MultiplySample(int multiple);  /** clones sample 'multiple'-times, e.g. for diffusion simulation */
 
+	void    SeedIsochromat(const size_t id); /** reseeds the random number generator with the isochromat ID */
+
+	int     NoComputing(); /** number of processes which simulate spins in parallel mode */
+
+	virtual void CopyVoxel(const size_t n, double* val); /** copies the properties of the n-th stored voxel */
+
+	void    AddCostFeatures(const size_t l, double* phi); /** adds the cost model features of the l-th spin */
+
+	int     PaketSize(int first, int maxNoSpins, int SlaveId); /** no of spins from 'first' which fit the time budget of a slave */
+
+	void    PaketSent(int noSpins, int NextSpinToSend, int SlaveId); /** bookkeeping of a paket sent to a slave */
+
 	Ensemble<double>     m_ensemble;
 
 
@@ -555,6 +669,9 @@ class Sample {
     RNG            m_rng;          /** < random number generator*/
     double         m_r2prime;      /** < R2-Prime == shaping parameter of the Lorentzian distribution */
     double         m_pos_rand_perc;/** < Percantage (of cartesian resolution) randomness in spin position .*/
+    int            m_isochromats;  /** < Number of isochromats generated on the fly from each voxel */
+    bool           m_iso_seeded;   /** < Draw random spin properties from a generator seeded with the spin ID */
+    vector<double> m_packet;       /** < Buffer of expanded isochromats for MPI send */
 
     SampleReorderStrategyInterface *m_reorder_strategy;
 
@@ -566,13 +683,17 @@ class Sample {
 // bookkeeping for restart:
     vector<char>  	m_spin_state;	/** keeps track whether spin is not touched (==0), sent (==1) or calculated (==2) */
     bool 			m_is_restart;	/** true if simulation run is from a restart */
+    Checkpoint*		m_checkpoint;	/** writes the restart information in the background */
     vector<int>		m_spins_sent;	/** no of spins last sent to each slave */
     vector<int>		m_last_offset_sent;/** offset to the last spins sent */
     vector<timeval> m_last_time;	/** last timepoint at which spins were sent */
+    vector< deque< pair<int,int> > > m_in_flight; /** pakets (offset, no spins) sent to each slave whose signal is outstanding */
+    deque< pair<int,int> > m_requeued; /** pakets (offset, no spins) of lost slaves, to be sent again */
     double			m_sent_interval;/** approx. time in seconds after which new spins are sent */
+    bool			m_master_computes;/** the master process simulates spins too */
 
-    double			m_total_cpu_time;
-    double			m_no_spins_done;
+    PaketScheduler	m_scheduler;	/** sizes the pakets from the measured simulation times */
+    vector<double>	m_cost_val;	/** buffer of spin properties for the cost model */
 
 	vector<double>  m_helper;
 	int             m_no_spin_compartments;
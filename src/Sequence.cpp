@@ -128,8 +128,31 @@ void Sequence::SeqDiag (const string& fname ) {
 /***********************************************************/
 bool Sequence::SeqISMRMRD (const string& fname ) {
 
+	std::string header;
+	std::vector<ISMRMRD::Acquisition> acqs;
+
+	bool img_adcs = SeqISMRMRD (header, acqs);
+	if (header.empty())
+		return false;
+
+	std::remove(fname.c_str()); // otherwise data is appended
+	ISMRMRD::Dataset d(fname.c_str(), "dataset", true);
+
+	for(size_t i=0; i<acqs.size(); ++i)
+		d.appendAcquisition(acqs[i]);
+	d.writeHeader(header);
+
+	return img_adcs;
+}
+
+/***********************************************************/
+bool Sequence::SeqISMRMRD (std::string& header, std::vector<ISMRMRD::Acquisition>& acqList) {
+
 	/* WIP: - Plot reconstruction results in GUI */
 
+	header.clear();
+	acqList.clear();
+
 	if ( GetNumOfTPOIs()==0  ) return false;
 
 	Prepare(PREP_INIT);
@@ -206,10 +229,6 @@ bool Sequence::SeqISMRMRD (const string& fname ) {
 	memcpy (&di[0], &seqdata[6*di.Size()], di.Size() * sizeof(double));
 	kz = cumtrapz(di,t,meta);
 
-	// Write acquisitions & trajectory to ISMRMRD file
-	std::remove(fname.c_str()); // otherwise data is appended
-	ISMRMRD::Dataset d(fname.c_str(), "dataset", true);
-
 	// Header
 	ISMRMRD::IsmrmrdHeader h;
 	ISMRMRD::AcquisitionSystemInformation sys;
@@ -253,7 +272,6 @@ bool Sequence::SeqISMRMRD (const string& fname ) {
 	e.reconSpace.fieldOfView_mm.z = (P->m_fov_z > 0) ? P->m_fov_z : 1;
 
 	// Acquisitions
-	std::vector<ISMRMRD::Acquisition> acqList;
 	ISMRMRD::Acquisition acq;
 	u_int16_t axes = 3;
 	u_int16_t readout;
@@ -336,9 +354,6 @@ bool Sequence::SeqISMRMRD (const string& fname ) {
 		}
 	}
 
-	for(size_t i=0; i<acqList.size(); ++i)
-		d.appendAcquisition(acqList[i]);
-
 	// Write encoding limits
 	e.encodingLimits.slice = ISMRMRD::Limit(0, slices-1, slices/2);
 	e.encodingLimits.kspace_encoding_step_1 = ISMRMRD::Limit(0, shots-1, shots/2);
@@ -349,11 +364,10 @@ bool Sequence::SeqISMRMRD (const string& fname ) {
 	e.encodingLimits.segment = ISMRMRD::Limit(0, 0, 0);
 	h.encoding.push_back(e);
 
-	// Serialize header and write it to the data file
+	// Serialize header
     std::stringstream str;
 	ISMRMRD::serialize( h, str);
-    std::string xml_header = str.str();
-	d.writeHeader(xml_header);
+    header = str.str();
 
 	return img_adcs;
 }
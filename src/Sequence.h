@@ -86,6 +86,15 @@ public:
      */
     bool  SeqISMRMRD  (const string& fname = "seq.h5");
 
+   /**
+     * ISMRMRD header and acquisitions (trajectory, flags and counters, no data)
+     *
+     * @param header  Serialized ISMRMRD header (empty without TPOIs)
+     * @param acqs    Acquisitions, one per ADC block
+     * @return        True, if imaging ADCs exist
+     */
+    bool  SeqISMRMRD  (std::string& header, std::vector<ISMRMRD::Acquisition>& acqs);
+
 
     /**
      * @brief Recursively collect sequence data (for plotting the sequence diagram)
@@ -43,9 +43,10 @@ Signal::Signal   (long samples) {
 }
 
 /**********************************************************/
-Signal::Signal   (long samples, int compartments) {
+Signal::Signal   (long samples, int compartments, bool compact) {
 	
 	//InitRandGenerator();
+	m_repository.SetCompact (compact);
 	m_repository.Initialize (samples, compartments);
 
 }
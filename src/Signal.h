@@ -27,9 +27,9 @@
 #ifndef SIGNAL_H_
 #define SIGNAL_H_
 
-#include "rng.h"
-
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <assert.h>
 using namespace std;
 
@@ -41,8 +41,11 @@ struct Repository {
 
 	long     m_noofsamples;      /**< Number of samples             */
 	int      m_noofcompartments; /** < Number of compartments       */
+	bool     m_compact;          /**< Mx, My only, in single precision */
 	std::vector<double> m_times;
 	std::vector<double> m_data;             /**< Data (column major)           */
+	std::vector<float>  m_cdata;            /**< Compact data (column major)   */
+	std::vector<float>  m_kahan;            /**< Lost low order bits of the compact data */
 
 
 	/**
@@ -52,6 +55,7 @@ struct Repository {
 
 		m_noofcompartments = 1; 
 		m_noofsamples      = 0;
+		m_compact          = false;
 		
 	};
 
@@ -76,17 +80,54 @@ struct Repository {
 
 
 	/**
-	 * @brief Reference to data repository
+	 * @brief Reference to data repository (not in compact mode, see Buffer)
 	 *
 	 * @return Refernce to data repository
 	 */
 	double* Data () {
 
+		assert(!m_compact);
 		return &m_data[0];
 
 	};
 	
 
+	/**
+	 * @brief Raw data as stored, i.e. float in compact mode, double otherwise
+	 *
+	 * @return Pointer to the data
+	 */
+	void* Buffer () {
+
+		return m_compact ? (void*) &m_cdata[0] : (void*) &m_data[0];
+
+	};
+	
+
+	/**
+	 * @brief Compact storage?
+	 *
+	 * @return True, if only Mx and My are stored in single precision
+	 */
+	inline const bool Compact () const {
+
+		return m_compact;
+
+	};
+
+
+	/**
+	 * @brief Choose the storage, before Initialize
+	 *
+	 * @param val  True: Mx and My in single precision with compensated summation
+	 */
+	inline void SetCompact (bool val) {
+
+		m_compact = val;
+
+	};
+
+
 	/**
 	 * @brief Reference to time point repository
 	 *
@@ -130,7 +171,19 @@ struct Repository {
 	 */
 	inline const int NProps () const {
 		
-		return 3 * m_noofcompartments;
+		return Stride() * m_noofcompartments;
+		
+	};
+
+
+	/**
+	 * @brief Number of values per compartment (Mx, My[, Mz])
+	 *
+	 * @return Number of values per compartment
+	 */
+	inline const int Stride () const {
+		
+		return m_compact ? 2 : 3;
 		
 	};
 
@@ -180,20 +233,107 @@ struct Repository {
 		m_noofcompartments = compartments;
 		m_noofsamples      = samples;
 
-		m_data.resize(Size());
+		if (m_compact) {
+			m_data.clear();
+			m_cdata.assign(Size(), 0.0f);
+			m_kahan.assign(Size(), 0.0f);
+		} else
+			m_data.assign(Size(), 0.0);
 		m_times.resize(Samples());
 
 	};
 
 
 	/**
-	 * @brief       Value at position in store
+	 * @brief Set all data to zero
+	 */
+	inline void Clear () {
+
+		if (m_compact) {
+			std::fill (m_cdata.begin(), m_cdata.end(), 0.0f);
+			std::fill (m_kahan.begin(), m_kahan.end(), 0.0f);
+		} else
+			std::fill (m_data.begin(), m_data.end(), 0.0);
+
+	};
+
+
+	/**
+	 * @brief       Add to a value in the store
+	 *
+	 * Compact data are summed with Kahan's compensation, so that the
+	 * contributions of millions of spins do not vanish in single precision.
+	 *
+	 * @param  pos  Position in store
+	 * @param  val  Value to add
+	 */
+	inline void Add (long pos, double val) {
+
+		assert(pos >= 0);
+		assert(pos <  Size());
+
+		if (!m_compact) {
+			m_data[pos] += val;
+			return;
+		}
+
+		float y = (float) (val - m_kahan[pos]);
+		float t = m_cdata[pos] + y;
+		m_kahan[pos] = (t - m_cdata[pos]) - y;
+		m_cdata[pos] = t;
+
+	};
+
+
+	/**
+	 * @brief       Value in the store
+	 * @param  pos  Position in store
+	 * @return      Value
+	 */
+	inline double Value (long pos) const {
+
+		return m_compact ? (double) m_cdata[pos] - (double) m_kahan[pos] : m_data[pos];
+
+	};
+
+
+	/**
+	 * @brief       Overwrite a value in the store
+	 * @param  pos  Position in store
+	 * @param  val  New value
+	 */
+	inline void Set (long pos, double val) {
+
+		if (m_compact) {
+			m_cdata[pos] = (float) val;
+			m_kahan[pos] = 0.0f;
+		} else
+			m_data[pos]  = val;
+
+	};
+
+
+	/**
+	 * @brief Move the compensation into the compact data, e.g. before sending them
+	 */
+	inline void Fold () {
+
+		if (m_compact)
+			for (long i = 0; i < Size(); i++)
+				Set (i, Value(i));
+
+	};
+
+
+	/**
+	 * @brief       Value at position in store (not in compact mode, see Value, Set and Add)
 	 * @param  pos  Desired position 
 	 * @return      Reference to pos-th value in the store
 	 */
 	inline double
 	&operator[]     (long pos) {
 		
+		assert(!m_compact);
 		assert(pos >= 0);
 		assert(pos <  Size());
 		
@@ -202,25 +342,27 @@ struct Repository {
 	};
 	
 	/**
-	 * @brief       Access to position in store
+	 * @brief       Access to position in store (not in compact mode, see Value)
 	 * @param  pos  Desired position 
 	 * @return      Reference to pos-th value in the store
 	 */
 	inline const double
 	operator[]     (long pos)  const {
 		
+		assert(!m_compact);
 		return m_data[pos];
 		
 	};
 	
 	/**
-	 * @brief       Value at position in store
+	 * @brief       Value at position in store (not in compact mode, see Value, Set and Add)
 	 * @param  pos  Desired position 
 	 * @return      Reference to pos-th value in the store
 	 */
 	inline double&     
 	at (long pos) {
 		
+		assert(!m_compact);
 		assert(pos >= 0);
 		assert(pos <  Size());
 		
@@ -229,13 +371,14 @@ struct Repository {
 	};
 	
 	/**
-	 * @brief       Access to position in store
+	 * @brief       Access to position in store (not in compact mode, see Value)
 	 * @param  pos  Desired position 
 	 * @return      Reference to pos-th value in the store
 	 */
 	inline const double
 	at (long pos)  const {
 		
+		assert(!m_compact);
 		return m_data[pos];
 		
 	};
@@ -277,8 +420,9 @@ class Signal {
 	 *
 	 * @param size Number of signal definition points
 	 * @param compartments Number of signal compartments
+	 * @param compact Store Mx and My only, in single precision
 	 */
-    Signal              (long size, int compartments);
+    Signal              (long size, int compartments, bool compact = false);
 
 	/**
 	 * Read in binary data from file
@@ -308,27 +452,8 @@ class Signal {
 	};
 
 
-	/**
-     * Initialize the random number generator
-     *
-     * @param val Any integer (default 1)
-     */
-    void    InitRandGenerator   (int val=1) { 
-		m_rng = RNG( val * (long ) clock() ); 
-	};
-
-	/**
-     * Initialize the random number generator
-     *
-     * @param val Any integer (default 1)
-     */
-    RNG*    Noise   () { 
-		return &m_rng;
-	};
-
 private:
 	
-    RNG        m_rng;        /**< @brief random number generator */
 	Repository m_repository; /**< @brief Signal repository       */
 
 };
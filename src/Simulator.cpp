@@ -30,11 +30,13 @@
 #include "DynamicVariables.h"
 #include "Trajectory.h"
 #include "MultiPoolSample.h"
+#include "AnalyticSample.h"
 #include "Bloch_McConnell_CV_Model.h"
 //MODIF
 #include "World.h"
 //MODIF***
 #include <cstdio>
+#include <ctime>
 #include <sstream>
 
 
@@ -43,7 +45,7 @@
 Simulator::Simulator() :
 	m_rx_coil_array (0), m_xio(0), m_domtree_error_rep (0), m_dom_doc(0), m_evol(0),
 	m_world (World::instance()), m_model(0), m_tx_coil_array(0), m_sample(0),
-	m_seqtree(0), m_sequence(0), m_state(0), m_signal_prefix("signals"), m_output_dir("") {
+	m_seqtree(0), m_sequence(0), m_state(0), m_signal_prefix("signals"), m_output_dir(""), m_own_world(true) {
 	Simulator ("simu.xml");
 }
 
@@ -51,7 +53,7 @@ Simulator::Simulator() :
 Simulator::Simulator ( const string& fname, const string& fsample, const string& frxarray,
 		const string& ftxarray, const string& fsequence, const string& fmodel) :
 	m_rx_coil_array (0), m_evol(0),	m_world (World::instance()), m_model(0), m_tx_coil_array(0),
-	m_seqtree(0), m_sample(0), m_sequence(0), m_signal_prefix("signals"), m_output_dir("") {
+	m_seqtree(0), m_sample(0), m_sequence(0), m_signal_prefix("signals"), m_output_dir(""), m_own_world(true) {
 
 	m_domtree_error_rep = new DOMTreeErrorReporter;
 	m_xio               = new XMLIO();
@@ -76,9 +78,11 @@ Simulator::Simulator ( const string& fname, const string& fsample, const string&
 
 		if ( fsample!="NoSample" ) {
 			SetSample(fsample);
+			if (!m_state) return;
 			SetModel(fmodel);
 			SetParameter();
 			m_sample->ReorderSample();
+			m_rx_coil_array->Compress(m_sample);
 		}
 
 
@@ -103,9 +107,23 @@ void Simulator::SetSample         (std::string fsample) {
 	std::string mult (GetAttr (GetElem ("sample"), "multiple"));
 	int multiple = !mult.empty() ? atoi(mult.c_str()) : 1;
 
-	m_sample = (type == "multipool") ?
-			new MultiPoolSample (fsample) :
-			new Sample (fsample,multiple);
+	if      (type == "multipool")
+		m_sample = new MultiPoolSample (fsample);
+	else if (type == "analytic")
+		m_sample = new AnalyticSample (fsample);
+	else
+		m_sample = new Sample (fsample,multiple);
+
+	// a sample which could not be read has no spins
+	if (m_sample->GetSize() == 0) {
+		cout << "Error in Simulator::SetSample() - no spins in sample " << fsample << endl;
+		m_state = false;
+		return;
+	}
+
+	std::string iso (GetAttr (GetElem ("sample"), "isochromats"));
+	if (!iso.empty())
+		m_sample->SetIsochromats(atoi(iso.c_str()));
 
 	m_world->TotalSpinNumber = m_sample->GetSize();
 	m_world->SetNoOfSpinProps(m_sample->GetNProps());
@@ -145,6 +163,16 @@ void Simulator::SetRxCoilArray      (string frxarray) {
 	if (!sp.empty())
 		m_rx_coil_array->SetSignalPrefix(sp);
 
+	m_rx_coil_array->SetSenMapCache(GetAttr(GetElem("RXcoilarray"), "SensMapCache"));
+
+	std::string vc (GetAttr(GetElem("RXcoilarray"), "VirtualCoils"));
+	if (!vc.empty())
+		m_rx_coil_array->SetVirtualCoils(atoi(vc.c_str()));
+	std::string ex (GetAttr(GetElem("RXcoilarray"), "ExpandVirtualCoils"));
+	m_rx_coil_array->SetExpandSignals(ex == "true" || ex == "1");
+	std::string cs (GetAttr(GetElem("RXcoilarray"), "CompactSignals"));
+	m_rx_coil_array->SetCompactSignals(cs == "true" || cs == "1");
+
 	m_rx_coil_array->Initialize(frxarray);
 	m_rx_coil_array->Populate();
 
@@ -158,6 +186,7 @@ void Simulator::SetTxCoilArray      (string ftxarray) {
 
 	m_tx_coil_array = new CoilArray();
 	m_tx_coil_array ->setMode(1);
+	m_tx_coil_array ->SetSenMapCache(GetAttr(GetElem("TXcoilarray"), "SensMapCache"));
 	m_tx_coil_array ->Initialize(ftxarray);
 	m_tx_coil_array ->Populate();
 
@@ -206,6 +235,16 @@ void Simulator::SetParameter      () {
 	string  	   PRN = GetAttr(element, "RandomNoise");
 	if (!PRN.empty()) m_world->RandNoise  = atof(PRN.c_str());
 
+	// noise and isochromats are repeatable (default seed 42), unless Seed="random" seeds from the clock
+	// (once per process; parallel jemris broadcasts the seed of the master)
+	static unsigned long clock_seed = (unsigned long) time(NULL);
+	string  	  Seed = GetAttr(element, "Seed");
+	if (Seed == "random") m_world->m_seed = clock_seed;
+	else if (!Seed.empty()) m_world->m_seed = strtoul(Seed.c_str(), NULL, 10);
+
+	string  CheckInt = GetAttr(element, "CheckpointInterval");
+	if (!CheckInt.empty() && atof(CheckInt.c_str()) > 0.0) m_world->m_checkpointInterval = atof(CheckInt.c_str());
+
 	string 	   LoadBal = GetAttr(element, "LoadBalancing");
 	if (!LoadBal.empty() && (atof(LoadBal.c_str()) == 1)) {
 		m_world->m_useLoadBalancing  = true;
@@ -219,6 +258,10 @@ void Simulator::SetParameter      () {
 	// load trajectories for dynamic variables:
 	DynamicVariables *dynVar = DynamicVariables::instance();
 
+	// time points outside of the trajectories: hold (default) or extrapolate
+	if (GetAttr(GetElem("sample"), "TrajectoryBounds") == "extrapolate")
+		TrajectoryInterface::SetBounds(BOUNDS_EXTRAPOLATE);
+
 //MODIF
 	string     Flow = GetAttr(GetElem("sample"), "FlowTrajectories");
 	if (!Flow.empty()) {
@@ -295,30 +338,32 @@ DOMElement* Simulator::GetElem    (string name) {
 }
 
 /**********************************************************/
-void Simulator::Simulate          (bool bDumpSignal) {
+void Simulator::Simulate          (bool bDumpSignal, bool bInitSignal) {
 
-	m_rx_coil_array->InitializeSignals (m_sequence->GetNumOfADCs());
+	if (bInitSignal)
+		m_rx_coil_array->InitializeSignals (m_sequence->GetNumOfADCs());
 
 	bool img_adcs = true;
+	std::string header;
+	std::vector<ISMRMRD::Acquisition> acqs;
 	if (bDumpSignal) {
 		m_kspace = new KSpace<double,4>();
 		KSpace<double,4>::KPoint p;
 		m_kspace->PushBack(p);
 		CheckRestart();
 
-		// Initialize temporary ISMRMRD file with sequence data
-		img_adcs = m_sequence->SeqISMRMRD(m_rx_coil_array->GetSignalOutputDir() + m_rx_coil_array->GetSignalPrefix() + "_ismrmrd_tmp.h5");
-		if (!img_adcs)
-			remove((m_rx_coil_array->GetSignalOutputDir() + m_rx_coil_array->GetSignalPrefix() + "_ismrmrd_tmp.h5").c_str());
+		// ISMRMRD header and acquisitions of the sequence, filled with the signals afterwards
+		img_adcs = m_sequence->SeqISMRMRD(header, acqs);
 	}
 
 	m_model->Solve();
 
 	if (bDumpSignal) {
+		m_rx_coil_array->ExpandSignals();
 		m_rx_coil_array->DumpSignals();
 		m_kspace->Write(m_rx_coil_array->GetSignalOutputDir() + m_rx_coil_array->GetSignalPrefix() + ".h5", "kspace", "/");
 		if (img_adcs)
-			m_rx_coil_array->DumpSignalsISMRMRD("_ismrmrd", true);
+			m_rx_coil_array->DumpSignalsISMRMRD(header, acqs, "_ismrmrd", true);
 		DeleteTmpFiles();
 	}
 
@@ -372,42 +417,23 @@ Simulator::~Simulator             () {
 	if (m_model             != NULL) delete m_model;
 	if (m_sample            != NULL) delete m_sample;
 	if (m_seqtree           != NULL) delete m_seqtree;
-	if (m_world             != NULL) delete m_world;
+	if (m_world             != NULL && m_own_world) delete m_world;
 
 }
 
 /**********************************************************/
 void Simulator::DeleteTmpFiles(){
-	remove(".spins_state.dat");
-	for (unsigned int i=0; i<m_rx_coil_array->GetSize(); i++) {
-		stringstream sstr;
-		sstr << ".tmp_sig" << setw(2) << setfill('0') << i+1 << ".bin";
-		remove(sstr.str().c_str());
-	}
+	m_sample->DeleteRestartInfo();
 }
 /**********************************************************/
 void Simulator::CheckRestart(){
-	int sampstate = m_sample->ReadSpinsState();
+	int sampstate = m_sample->ReadSpinsState(m_rx_coil_array);
 	if (sampstate == -1) MoveTmpFiles();
-	if (sampstate == 0) {
-		int sigstate=m_rx_coil_array->ReadRestartSignal();
-		if (sigstate == 0) {
-			cout << "\nRestart files found. Resuming calculation.\n" << endl;
-			return;
-		}
-		MoveTmpFiles();
-		m_sample->ClearSpinsState();
-	}
+	if (sampstate == 0)
+		cout << "\nRestart files found. Resuming calculation.\n" << endl;
 }
 /**********************************************************/
 void Simulator::MoveTmpFiles(){
-	cout << "Restart file does not fit to current simulation. move .spins_state.dat to spins_state.bak; .tmp_sig*.bin to tmp_sig.bak. " << endl;
-	rename(".spins_state.dat","spins_state.bak");
-	for (unsigned int j=0;j<m_rx_coil_array->GetSize();j++) {
-	    stringstream sstr1,sstr2;
-		sstr1 << ".tmp_sig" << setw(2) << setfill('0') << j+1 << ".bin";
-		sstr2 << "tmp_sig" << setw(2) << setfill('0') << j+1 << ".bak";
-		rename(sstr1.str().c_str(),sstr2.str().c_str());
-	}
-
+	cout << "Restart file does not fit to current simulation. move .restart0.dat, .restart1.dat to restart0.bak, restart1.bak. " << endl;
+	Checkpoint::Backup();
 }
@@ -107,8 +107,11 @@ class Simulator {
 
 	/**
 	 * @brief Start the simulation after every necessary credentials have been set
+	 *
+	 * @param bDumpSignal  Write signal files at the end
+	 * @param bInitSignal  Reset the signals before; false accumulates onto the signal of the previous call
 	 */
-	void        Simulate     (bool bDumpSignal = true);
+	void        Simulate     (bool bDumpSignal = true, bool bInitSignal = true);
 
 	/**
 	 * @brief Set my sample from XML
@@ -182,6 +185,11 @@ class Simulator {
 	 */
 	void      SetWorld       ();
 
+	/**
+	 * @brief The world singleton is owned by another simulator: do not delete it
+	 */
+	void      ShareWorld     () { m_own_world = false; };
+
 	/**
 	 * @brief Set up my recieve coils according to XML configuration
 	 */
@@ -225,6 +233,7 @@ class Simulator {
 	DOMDocument*             m_dom_doc;           /**< @brief Simulation file             */
 	Sample*                  m_sample;            /**< @brief Sample                      */
 	World*                   m_world;             /**< @brief World to be simulated       */
+	bool                     m_own_world;         /**< @brief Delete the world on destruction */
 	Model*                   m_model;			  /**< @brief Model to be simulated       */
 	ConcatSequence*          m_sequence;          /**< @brief Sequence to be simulated    */
 	SequenceTree*            m_seqtree;           /**< @brief SequenceTree to be simulated*/
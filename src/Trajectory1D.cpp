@@ -75,6 +75,7 @@ void Trajectory1D::LoadFile(string filename) {
     	m_time.push_back(seqDuration + 1);
     	m_data.push_back(m_data.back());
     }
+    SetupGrid();
 /*
     cout << filename;
     cout << " datapoints: time = " <<m_time.size()  << "; data: " << m_data.size()<<endl;
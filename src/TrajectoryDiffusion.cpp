@@ -37,6 +37,13 @@
 #include "rng.h"
 #include "SequenceTree.h"
 #include "ConcatSequence.h"
+#include "BinaryContext.h"
+
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
 
 TrajectoryDiffusion::TrajectoryDiffusion() {
 	m_seed = 42;
@@ -46,6 +53,11 @@ TrajectoryDiffusion::TrajectoryDiffusion() {
 	m_timestep=0.05;//in ms
 	m_mode=BOTH;
 	m_diff_dimension=3;  //default : diffusion in 3 dimensions
+	m_cur_pos=NULL;
+	m_cur_y=NULL;
+	m_bank_size=0;
+	m_bank_pos=NULL;
+	m_bank_y=NULL;
 
 	// init xml reader:
 	m_domtree_error_rep = new DOMTreeErrorReporter;
@@ -81,10 +93,9 @@ void TrajectoryDiffusion::LoadFile(string filename) {
 	cout << "Diffusion file: "<<filename<<endl;
 	// read xml-file:
 	m_dom_doc           = m_xio->Parse(filename);
+	m_filename          = filename;
 	DOMElement* element = GetElem("Diffusion");
 
-    World*pw = World::instance();
-
     /***************** Read values valid for any diffusion type: *************/
     // Diffusion type:
 	string type = GetAttr(element, "DiffusionType");
@@ -140,9 +151,13 @@ void TrajectoryDiffusion::LoadFile(string filename) {
     }
 	cout<< "'Pool' = "<<m_mode<<" (0 == simulate internal+external spins, 1 == only internal spins, 2 == only external spins)" <<endl;
 
-    // read seed for diffusion trajectory; if parallel jemris is used, even same seed values do not guarantee identical simulation results since the distribution of spins to each parallel process is non-deterministic.
+    // read seed for diffusion trajectory; the random walks are keyed by (seed, spin ID), so equal seeds give identical results,
+    // also in parallel jemris, whatever process simulates a spin. Without a seed, every run uses the default seed (42).
+    // Seed="random" seeds from the clock; then each process of parallel jemris draws its own seed, and runs are not repeatable.
     string Seed = GetAttr(element, "Seed");
-    if (Seed.empty()) {cout << "'Seed' not set in XML file. using default diffusion trajectory seed: " << m_seed <<endl;} else {SetSeed((long) atoi(Seed.c_str())); cout <<"Diffusion 'Seed': = " <<m_seed<<endl;};
+    if (Seed.empty()) {cout << "'Seed' not set in XML file. using default diffusion trajectory seed: " << m_seed <<endl;}
+    else if (Seed == "random") {static long clock_seed = (long) time(NULL); SetSeed(clock_seed); cout <<"Diffusion 'Seed': = " <<m_seed<<" (random)"<<endl;}
+    else {SetSeed((long) atoi(Seed.c_str())); cout <<"Diffusion 'Seed': = " <<m_seed<<endl;};
 
     // read the spin numbers for which the trajectory should be dumped for debug/visualization purposes. Can specify as many as wanted, read until end of file.
     string DumpTrajectory = GetAttr(element, "DumpTrajectory");
@@ -395,16 +410,29 @@ void TrajectoryDiffusion::LoadFile(string filename) {
 
 
     if (m_rng!=NULL) delete m_rng;
-    // multiply diffusion seed value with parallel jemris rank, so that each job as a different seed. (+2 because serial jemris has m_myRank=-1.)
-    m_rng=new RNG(m_seed*(pw->m_myRank+2));
+    // keyed per spin in GenerateDiffusionTrajectory
+    m_rng=new RNG(m_seed);
+
+    // trajectory bank: spins draw from a fixed set of walks instead of generating their own
+    string Bank = GetAttr(element, "TrajectoryBank");
+    m_bank_size = Bank.empty() ? 0 : atol(Bank.c_str());
+    if (m_bank_size < 0) m_bank_size = 0;
+    m_bank_file = GetAttr(element, "TrajectoryBankFile");
+    if (m_bank_size > 0) {
+    	cout << "'TrajectoryBank' = " << m_bank_size << " random walks shared by all spins";
+    	if (!m_bank_file.empty()) cout << ", stored in '" << m_bank_file << "'";
+    	cout << "." << endl;
+    	GenerateBank();
+    } else {
+    	cout << "'TrajectoryBank' not set in XML file. Each spin has its own random walk." << endl;
+    }
 
     cout <<"------------------------ End Diffusion simulation variables ----------------------\n"<<endl;
 
 }
 /***********************************************************/
 void TrajectoryDiffusion::SetSeed(long seed) {
-	World* pw=World::instance();
-	if (pw->m_myRank>0) m_seed=seed*pw->m_myRank; else m_seed=seed;
+	m_seed=seed;
 	return;
 }
 /***********************************************************/
@@ -413,48 +441,88 @@ void TrajectoryDiffusion::UpdateTrajectory(bool init) {
 	if (m_microstruct==NULL) return;
 
 	if (init) {
-		m_time.clear();
-		m_pos.clear();
-		m_y.clear();
-		GenerateDiffusionTrajectory();
+		if (m_bank_size > 0)
+			DrawFromBank();
+		else
+			GenerateDiffusionTrajectory();
 	}
 
+}
+/***********************************************************/
+void TrajectoryDiffusion::TimeGrid() {
+
+	SequenceTree* pSeqTree = World::instance()->pSeqTree;
+	double seqDuration = pSeqTree->GetRootConcatSequence()->GetDuration();
+
+	long steps = (int) ((seqDuration+0.01)/m_timestep)+2;
+	if (steps > m_max_timesteps) {
+		m_timestep = seqDuration/m_max_timesteps;
+		cout << "Sequence too long; increasing Delta t to: " <<m_timestep << "ms." << endl;
+	}
+
+	m_time.clear();
+	m_time.push_back(0.0);
+	while (m_time.back()<=seqDuration)
+		m_time.push_back(m_time.back()+m_timestep);
+	SetupGrid();
+
 }
 /***********************************************************/
 void TrajectoryDiffusion::GenerateDiffusionTrajectory() {
 
+	// the walk depends on the seed and the global spin ID only, not on the process simulating it
+	World* pw = World::instance();
+	m_rng->init(m_seed, pw->getTrajBegin() + pw->SpinNumber, RNG_DIFFUSION);
+
+	TimeGrid();
+	m_pos.resize(m_time.size());
+	m_y.resize(m_time.size());
+	RandomWalk(m_rng, &m_pos[0]);
+	CalcY(&m_pos[0], &m_y[0]);
+	m_cur_pos = &m_pos[0];
+	m_cur_y   = &m_y[0];
+
+	DumpSpin();
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::DumpSpin() {
+
+	static int counter=0;
+	for (unsigned int i=0; i<m_dump_index.size();i++) {
+		if (counter == m_dump_index[i]) {
+	        stringstream sstr;
+	        sstr << "trajectory_spin" << setw(5) << setfill('0') << counter << ".dat";
+	      	DumpTrajectory(sstr.str());
+		}
+	}
+	counter++;
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::RandomWalk(RNG* rng, triple* pos) {
+
 	triple trialpos;
 
 	int ObjectIndex=-1,ShellIndex=-1;
 	int TrialObjID=-1, TrialShellID=-1;
 
 	do {
-		trialpos.x=m_rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
-		trialpos.y=m_rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
-		trialpos.z=m_rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
+		trialpos.x=rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
+		trialpos.y=rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
+		trialpos.z=rng->uniform(-m_microstruct->GetBoxSize(),m_microstruct->GetBoxSize());
 		m_microstruct->IndexObject(trialpos,ObjectIndex,ShellIndex);
 	} while (!((m_mode==BOTH) | ((ObjectIndex==-1)& (m_mode==EXTERNAL) ) | ((ObjectIndex>-1)& (m_mode==INTERNAL) )  ));
 
-	m_time.push_back(0.0);
-	m_pos.push_back(trialpos);
-
-
-	SequenceTree* pSeqTree = World::instance()->pSeqTree;
-	double seqDuration = pSeqTree->GetRootConcatSequence()->GetDuration();
-
-	long steps = (int) ((seqDuration+0.01)/m_timestep)+2;
-	if (steps > m_max_timesteps) {
-		m_timestep = seqDuration/m_max_timesteps;
-		cout << "Sequence too long; increasing Delta t to: " <<m_timestep << "ms." << endl;
-	}
+	pos[0] = trialpos;
 
 	// diffusion direction for 1-d and plane normal for 2-d diffusion:
 	triple diff_dir;
 	double norm;
 	do{
-		diff_dir.x=m_rng->uniform(-1.0,1.0);
-		diff_dir.y=m_rng->uniform(-1.0,1.0);
-		diff_dir.z=m_rng->uniform(-1.0,1.0);
+		diff_dir.x=rng->uniform(-1.0,1.0);
+		diff_dir.y=rng->uniform(-1.0,1.0);
+		diff_dir.z=rng->uniform(-1.0,1.0);
 		norm = sqrt(diff_dir.x*diff_dir.x + diff_dir.y*diff_dir.y + diff_dir.z*diff_dir.z);
 	} while (norm > 1.0); //sample from sphere, not from box.
 	diff_dir.x/=norm;
@@ -465,14 +533,13 @@ void TrajectoryDiffusion::GenerateDiffusionTrajectory() {
 
 	double sigma;
 	sigma = sqrt(2*m_microstruct->GetD(ObjectIndex,ShellIndex)*m_timestep);
-	int i=1;
-	while (m_time.back()<=seqDuration) {
+	for (unsigned int i=1; i<m_time.size(); i++) {
 		bool accept;
 		do {
-			trialpos.x=m_pos[i-1].x + m_rng->normal(0,sigma);
-			trialpos.y=m_pos[i-1].y + m_rng->normal(0,sigma);
-			trialpos.z=m_pos[i-1].z + m_rng->normal(0,sigma);
-			if (m_diff_dimension!=3) {ProjectPosition(trialpos,diff_dir);}
+			trialpos.x=pos[i-1].x + rng->normal(0,sigma);
+			trialpos.y=pos[i-1].y + rng->normal(0,sigma);
+			trialpos.z=pos[i-1].z + rng->normal(0,sigma);
+			if (m_diff_dimension!=3) {ProjectPosition(trialpos,diff_dir,pos[0]);}
 			accept = m_microstruct->isInsideBox(trialpos);
 
 			// compartment exchange probability could be implemented here:
@@ -487,79 +554,298 @@ void TrajectoryDiffusion::GenerateDiffusionTrajectory() {
 //				sigma = sqrt(2*m_microstruct->GetD(TrialObjID,TrialShellID)*m_timestep);
 
 		} while (!accept);
-		m_time.push_back(m_time.back()+m_timestep);
-		m_pos.push_back(trialpos);
-		i++;
+		pos[i] = trialpos;
 	}
-	CalcY();
-	static int counter=0;
-	for (unsigned int i=0; i<m_dump_index.size();i++) {
-		if (counter == m_dump_index[i]) {
-	        stringstream sstr;
-	        sstr << "trajectory_spin" << setw(5) << setfill('0') << counter << ".dat";
-	      	DumpTrajectory(sstr.str());
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::WalkBlock(long first, int count) {
+
+	long   n     = m_time.size();
+	double bs    = m_microstruct->GetBoxSize();
+	double scale = 1.0/4294967296.0;
+	ulong  r[4];
+
+	// walkers as structure of arrays; walker j draws from counters (first+j, 0,1,2,...)
+	vector<double> x(count), y(count), z(count), ox(count), oy(count), oz(count);
+	vector<double> dx(count), dy(count), dz(count), sigma(count);
+	vector<int>    obj(count,-1), shell(count,-1);
+	vector<ulong>  id(count), cnt(count);
+
+	// start positions and diffusion directions
+	for (int j=0; j<count; j++) {
+		id[j]  = first + j;
+		cnt[j] = 0;
+		triple p;
+		do {
+			RNG::counter(m_seed, id[j], RNG_DIFFUSION_WALK, cnt[j]++, r);
+			p.x = bs*(2.0*r[0]*scale-1.0);
+			p.y = bs*(2.0*r[1]*scale-1.0);
+			p.z = bs*(2.0*r[2]*scale-1.0);
+			m_microstruct->IndexObject(p,obj[j],shell[j]);
+		} while (!((m_mode==BOTH) | ((obj[j]==-1)& (m_mode==EXTERNAL) ) | ((obj[j]>-1)& (m_mode==INTERNAL) )  ));
+		x[j] = ox[j] = p.x;
+		y[j] = oy[j] = p.y;
+		z[j] = oz[j] = p.z;
+		m_bank[id[j]*n] = p;
+
+		double norm;
+		do {
+			RNG::counter(m_seed, id[j], RNG_DIFFUSION_WALK, cnt[j]++, r);
+			dx[j] = 2.0*r[0]*scale-1.0;
+			dy[j] = 2.0*r[1]*scale-1.0;
+			dz[j] = 2.0*r[2]*scale-1.0;
+			norm  = sqrt(dx[j]*dx[j] + dy[j]*dy[j] + dz[j]*dz[j]);
+		} while (norm > 1.0 || norm == 0.0);
+		dx[j] /= norm; dy[j] /= norm; dz[j] /= norm;
+
+		sigma[j] = sqrt(2*m_microstruct->GetD(obj[j],shell[j])*m_timestep);
+	}
+
+	// trial steps of the walkers not yet moved; compacted after each round
+	vector<int>    todo(count);
+	vector<ulong>  tid(count), tcnt(count);
+	vector<double> tx(count), ty(count), tz(count);
+	vector<char>   accept(count);
+
+	for (long i=1; i<n; i++) {
+		int m = count;
+		for (int j=0; j<count; j++)
+			todo[j] = j;
+
+		while (m > 0) {
+			for (int k=0; k<m; k++) {
+				tid[k]  = id[todo[k]];
+				tcnt[k] = cnt[todo[k]]++;
+			}
+			RNG::normal3(m_seed, RNG_DIFFUSION_WALK, m, &tid[0], &tcnt[0], &tx[0], &ty[0], &tz[0]);
+
+			for (int k=0; k<m; k++) {
+				int j = todo[k];
+				tx[k] = x[j] + sigma[j]*tx[k];
+				ty[k] = y[j] + sigma[j]*ty[k];
+				tz[k] = z[j] + sigma[j]*tz[k];
+			}
+
+			if (m_diff_dimension!=3)
+				for (int k=0; k<m; k++) {
+					int j = todo[k];
+					triple p = {tx[k], ty[k], tz[k]}, d = {dx[j], dy[j], dz[j]}, o = {ox[j], oy[j], oz[j]};
+					ProjectPosition(p,d,o);
+					tx[k] = p.x; ty[k] = p.y; tz[k] = p.z;
+				}
+
+			for (int k=0; k<m; k++)
+				accept[k] = (fabs(tx[k])<bs) & (fabs(ty[k])<bs) & (fabs(tz[k])<bs);
+
+			// spins are not allowed to leave their object (see RandomWalk)
+			for (int k=0; k<m; k++)
+				if (accept[k]) {
+					int j = todo[k];
+					int o = obj[j], s = shell[j];
+					triple p = {tx[k], ty[k], tz[k]};
+					m_microstruct->IndexObject(p,o,s);
+					accept[k] = (o == obj[j]) && (s == shell[j]);
+				}
+
+			// move the accepted walkers, retry the rejected ones
+			int left = 0;
+			for (int k=0; k<m; k++) {
+				int j = todo[k];
+				if (accept[k]) {
+					x[j] = tx[k]; y[j] = ty[k]; z[j] = tz[k];
+					triple& p = m_bank[id[j]*n+i];
+					p.x = x[j]; p.y = y[j]; p.z = z[j];
+				} else
+					todo[left++] = j;
+			}
+			m = left;
 		}
 	}
-	counter++;
+
+	for (int j=0; j<count; j++)
+		CalcY(&m_bank[id[j]*n], &m_bank[(m_bank_size+id[j])*n]);
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::GenerateBank() {
+
+	World* pW = World::instance();
+
+	// the master of parallel jemris only distributes spins
+	if (pW->m_myRank == 0) return;
+
+	TimeGrid();
+	long n = m_time.size();
+	bool shared = (pW->shareFunPtr != NULL);
+
+	// slaves load the parameters once per sample: keep the bank if nothing it depends on changed
+	stringstream key;
+	key << setprecision(17) << m_filename << " " << m_seed << " " << m_bank_size << " " << n << " " << m_time.back();
+	if (m_bank_pos != NULL && key.str() == m_bank_key) {
+		cout << "reusing " << m_bank_size << " diffusion trajectories." << endl;
+		return;
+	}
+	m_bank_key = key.str();
+
+	// positions of all walks, followed by their spline coefficients
+	if (!shared || pW->m_node_rank == 0) {
+		if (!ReadBank()) {
+			cout << "generating " << m_bank_size << " diffusion trajectories ..." << endl;
+			m_bank.resize(2*m_bank_size*n);
+			m_microstruct->UpdateIndex();
+
+			// walk k is keyed by k only, so the bank does not depend on the number of threads;
+			// the threads take blocks of walkers, which are advanced step by step together
+			const long block = 1024;
+			int nthreads = std::thread::hardware_concurrency();
+			if (nthreads < 1) nthreads = 1;
+			std::atomic<long> next (0);
+			vector<std::thread> threads;
+			for (int t=0; t<nthreads; t++)
+				threads.push_back(std::thread([this, block, &next]() {
+					long first;
+					while ((first = block*next++) < m_bank_size)
+						WalkBlock(first, (int) min(block, m_bank_size-first));
+				}));
+			for (int t=0; t<nthreads; t++)
+				threads[t].join();
+
+			// serial jemris or the first slave
+			if (pW->m_myRank <= 1 && !m_bank_file.empty())
+				WriteBank();
+		}
+	}
+
+	if (shared) {
+		size_t bytes = m_bank.size()*sizeof(triple);
+		m_bank_pos = (const triple*) pW->shareFunPtr(m_bank.data(), bytes);
+		vector<triple>().swap(m_bank);
+	} else
+		m_bank_pos = m_bank.data();
+	m_bank_y = m_bank_pos + m_bank_size*n;
+
+}
+/***********************************************************/
+bool TrajectoryDiffusion::ReadBank() {
+
+	if (m_bank_file.empty()) return false;
+	ifstream test (m_bank_file.c_str());
+	if (!test.is_open()) return false;
+	test.close();
+
+	BinaryContext bc (m_bank_file, IO::IN);
+	NDData<double> data, time;
+	if (bc.Status() != IO::OK || bc.Read(time, "time", "/diffusion") != IO::OK || bc.Read(data, "bank", "/diffusion") != IO::OK)
+		return false;
+
+	// the bank has to match the time grid
+	long n = m_time.size();
+	if ((long) time.Size() != n || fabs(time[n-1] - m_time[n-1]) > 1e-9*m_time[n-1] || (long) data.Size() != 2*m_bank_size*n*3) {
+		cout << "diffusion trajectory bank " << m_bank_file << " does not match the simulation; generating a new one." << endl;
+		return false;
+	}
+
+	m_bank.resize(2*m_bank_size*n);
+	memcpy (m_bank.data(), data.Ptr(), data.Size()*sizeof(double));
+	cout << "read " << m_bank_size << " diffusion trajectories from " << m_bank_file << endl;
+	return true;
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::WriteBank() {
+
+	long n = m_time.size();
+	NDData<double> data (3, n, 2*m_bank_size);
+	memcpy (data.Ptr(), m_bank.data(), data.Size()*sizeof(double));
+	NDData<double> time (n);
+	memcpy (time.Ptr(), m_time.data(), n*sizeof(double));
+
+	// write under a temporary name, such that no process reads a partial file
+	string tmp = m_bank_file + ".tmp";
+	{
+		BinaryContext bc (tmp, IO::OUT);
+		if (bc.Status() != IO::OK) return;
+		bc.Write(time, "time", "/diffusion");
+		bc.Write(data, "bank", "/diffusion");
+	}
+	rename(tmp.c_str(), m_bank_file.c_str());
+
+}
+/***********************************************************/
+void TrajectoryDiffusion::DrawFromBank() {
+
+	// counter-based choice: depends on the seed and the global spin ID only
+	World* pw = World::instance();
+	ulong r[4];
+	RNG::counter(m_seed, pw->getTrajBegin() + pw->SpinNumber, RNG_DIFFUSION_BANK, 1, r);
+	long k = (long) ((r[0]*4294967296.0 + r[1]) / 18446744073709551616.0 * m_bank_size);
+	if (k >= m_bank_size) k = m_bank_size-1;
+
+	long n = m_time.size();
+	m_cur_pos = m_bank_pos + k*n;
+	m_cur_y   = m_bank_y   + k*n;
+
+	DumpSpin();
 
 }
 /***********************************************************/
-void TrajectoryDiffusion::CalcY() {
+void TrajectoryDiffusion::CalcY(const triple* pos, triple* y) {
 	double p,sig;
+	long n = m_time.size();
 	vector<double> store;
 	// init store to length of pos:
-	store.resize(m_pos.size());
-	m_y.resize(m_pos.size());
+	store.resize(n);
 	store.back()= 0;
 	store[0] 	= 0;
-	m_y[0].x	= 0;
-	m_y.back().x= 0;
+	y[0].x	= 0;
+	y[n-1].x= 0;
 
-	for (int i = 1; i<=m_y.size()-2;i++) {
+	for (int i = 1; i<=n-2;i++) {
 		sig = (m_time[i]-m_time[i-1])/(m_time[i+1]-m_time[i-1]);
-		p 	= sig*m_y[i-1].x+2.0;
-		m_y[i].x = (sig-1.0)/p;
-		store[i] = (m_pos[i+1].x - m_pos[i].x)/(m_time[i+1]-m_time[i]) - (m_pos[i].x - m_pos[i-1].x)/(m_time[i]-m_time[i-1]);
+		p 	= sig*y[i-1].x+2.0;
+		y[i].x = (sig-1.0)/p;
+		store[i] = (pos[i+1].x - pos[i].x)/(m_time[i+1]-m_time[i]) - (pos[i].x - pos[i-1].x)/(m_time[i]-m_time[i-1]);
 		store[i] = (6.0*store[i]/(m_time[i+1]-m_time[i-1]) - sig*store[i-1])/p;
 	}
 
-	for (int k=m_y.size()-2;k>=0;k--) {
-		m_y[k].x = m_y[k].x*m_y[k+1].x+store[k];
+	for (int k=n-2;k>=0;k--) {
+		y[k].x = y[k].x*y[k+1].x+store[k];
 	}
 
 	store.back()= 0;
 	store[0] 	= 0;
-	m_y[0].y	= 0;
-	m_y.back().y= 0;
+	y[0].y	= 0;
+	y[n-1].y= 0;
 
-	for (int i = 1; i<=m_y.size()-2;i++) {
+	for (int i = 1; i<=n-2;i++) {
 		sig = (m_time[i]-m_time[i-1])/(m_time[i+1]-m_time[i-1]);
-		p 	= sig*m_y[i-1].y+2.0;
-		m_y[i].y = (sig-1.0)/p;
-		store[i] = (m_pos[i+1].y - m_pos[i].y)/(m_time[i+1]-m_time[i]) - (m_pos[i].y - m_pos[i-1].y)/(m_time[i]-m_time[i-1]);
+		p 	= sig*y[i-1].y+2.0;
+		y[i].y = (sig-1.0)/p;
+		store[i] = (pos[i+1].y - pos[i].y)/(m_time[i+1]-m_time[i]) - (pos[i].y - pos[i-1].y)/(m_time[i]-m_time[i-1]);
 		store[i] = (6.0*store[i]/(m_time[i+1]-m_time[i-1]) - sig*store[i-1])/p;
 	}
 
-	for (int k=m_y.size()-2;k>=0;k--) {
-		m_y[k].y = m_y[k].y*m_y[k+1].y+store[k];
+	for (int k=n-2;k>=0;k--) {
+		y[k].y = y[k].y*y[k+1].y+store[k];
 	}
 
 
 	store.back()= 0;
 	store[0] 	= 0;
-	m_y[0].z	= 0;
-	m_y.back().z= 0;
+	y[0].z	= 0;
+	y[n-1].z= 0;
 
-	for (unsigned int i = 1; i<=m_y.size()-2;i++) {
+	for (int i = 1; i<=n-2;i++) {
 		sig = (m_time[i]-m_time[i-1])/(m_time[i+1]-m_time[i-1]);
-		p 	= sig*m_y[i-1].z+2.0;
-		m_y[i].z = (sig-1.0)/p;
-		store[i] = (m_pos[i+1].z - m_pos[i].z)/(m_time[i+1]-m_time[i]) - (m_pos[i].z - m_pos[i-1].z)/(m_time[i]-m_time[i-1]);
+		p 	= sig*y[i-1].z+2.0;
+		y[i].z = (sig-1.0)/p;
+		store[i] = (pos[i+1].z - pos[i].z)/(m_time[i+1]-m_time[i]) - (pos[i].z - pos[i-1].z)/(m_time[i]-m_time[i-1]);
 		store[i] = (6.0*store[i]/(m_time[i+1]-m_time[i-1]) - sig*store[i-1])/p;
 	}
 
-	for (int k=m_y.size()-2;k>=0;k--) {
-		m_y[k].z = m_y[k].z*m_y[k+1].z+store[k];
+	for (int k=n-2;k>=0;k--) {
+		y[k].z = y[k].z*y[k+1].z+store[k];
 	}
 
 
@@ -589,9 +875,9 @@ void TrajectoryDiffusion::GetValueDerived(double time, double *pos) {
 	double ta=(a*a*a-a);
 	double tb=(b*b*b-b);
 	step/=6.0;
-	pos[0] += a*m_pos[ilo].x + b*m_pos[ilo + 1].x + (ta*m_y[ilo].x + tb*m_y[ilo + 1].x)*step;
-	pos[1] += a*m_pos[ilo].y + b*m_pos[ilo + 1].y + (ta*m_y[ilo].y + tb*m_y[ilo + 1].y)*step;
-	pos[2] += a*m_pos[ilo].z + b*m_pos[ilo + 1].z + (ta*m_y[ilo].z + tb*m_y[ilo + 1].z)*step;
+	pos[0] += a*m_cur_pos[ilo].x + b*m_cur_pos[ilo + 1].x + (ta*m_cur_y[ilo].x + tb*m_cur_y[ilo + 1].x)*step;
+	pos[1] += a*m_cur_pos[ilo].y + b*m_cur_pos[ilo + 1].y + (ta*m_cur_y[ilo].y + tb*m_cur_y[ilo + 1].y)*step;
+	pos[2] += a*m_cur_pos[ilo].z + b*m_cur_pos[ilo + 1].z + (ta*m_cur_y[ilo].z + tb*m_cur_y[ilo + 1].z)*step;
 
 
 
@@ -602,30 +888,30 @@ void TrajectoryDiffusion::DumpTrajectory(string filename) {
     outFile.open(filename.c_str(), ofstream::out);
     outFile << "% time [ms];  x[mm] y[mm] z[mm]"<<endl;
     for (unsigned int i=0; i<m_time.size(); i++) {
-    	outFile << m_time[i] << " "<<m_pos[i].x<< " "<<m_pos[i].y << " "<<m_pos[i].z << endl;
+    	outFile << m_time[i] << " "<<m_cur_pos[i].x<< " "<<m_cur_pos[i].y << " "<<m_cur_pos[i].z << endl;
     }
 	outFile.close();
 	cout << "dump done."<<endl;
 
 }
 /***********************************************************/
-void TrajectoryDiffusion::ProjectPosition(triple &pos, triple dir){
+void TrajectoryDiffusion::ProjectPosition(triple &pos, triple dir, const triple &origin){
 	// dir needs to be normed!!
 	if (m_diff_dimension==1) {
-		// (pos - m_pos[0])
+		// (pos - origin)
 		triple D;
-		D.x=pos.x-m_pos[0].x;D.y=pos.y-m_pos[0].y;D.z=pos.z-m_pos[0].z;
+		D.x=pos.x-origin.x;D.y=pos.y-origin.y;D.z=pos.z-origin.z;
 		double proj;
 		proj= D.x*dir.x + D.y*dir.y + D.z*dir.z;
-		pos.x=m_pos[0].x + proj*dir.x;
-		pos.y=m_pos[0].y + proj*dir.y;
-		pos.z=m_pos[0].z + proj*dir.z;
+		pos.x=origin.x + proj*dir.x;
+		pos.y=origin.y + proj*dir.y;
+		pos.z=origin.z + proj*dir.z;
 
 		return;
 	}
 	if (m_diff_dimension==2) {
 		triple D;
-		D.x=pos.x-m_pos[0].x;D.y=pos.y-m_pos[0].y;D.z=pos.z-m_pos[0].z;
+		D.x=pos.x-origin.x;D.y=pos.y-origin.y;D.z=pos.z-origin.z;
 		double proj;
 		proj= D.x*dir.x + D.y*dir.y + D.z*dir.z;
 
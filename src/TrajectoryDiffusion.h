@@ -69,7 +69,18 @@ private:
 	DOMElement* 	GetElem    		(string name);
 
 	void GenerateDiffusionTrajectory();
-	void CalcY();						// calc information for cubic spline interpolation.
+	void CalcY(const triple* pos, triple* y);		// calc information for cubic spline interpolation.
+
+	void TimeGrid();					// time points of the trajectories
+	void RandomWalk(RNG* rng, triple* pos);			// one random walk on the time grid (thread safe)
+	void DumpSpin();					// dump the trajectory of the current spin, if requested
+
+	// trajectory bank: walks generated in advance, spins draw one of them
+	void GenerateBank();
+	void WalkBlock(long first, int count);		// walks first,...,first+count-1 of the bank at once (thread safe)
+	void DrawFromBank();
+	bool ReadBank();
+	void WriteBank();
 
 	void SetSeed(long seed);
 
@@ -79,6 +90,18 @@ private:
 	// vector for cubic splines interpolation:
 	vector<triple> m_y;
 
+	// trajectory of the current spin
+	const triple* m_cur_pos;
+	const triple* m_cur_y;
+
+	long           m_bank_size;	// number of walks in the bank; 0: a new walk for each spin
+	string         m_bank_file;	// HDF5 file to read the bank from or write it to
+	vector<triple> m_bank;		// positions of all walks, then their spline coefficients; unless shared
+	const triple*  m_bank_pos;
+	const triple*  m_bank_y;
+	string         m_bank_key;	// diffusion file, seed, size and time grid the bank was generated for
+	string         m_filename;	// diffusion file
+
 	unsigned long m_seed;
 	RNG* m_rng;
 
@@ -91,7 +114,7 @@ private:
 	vector<int> m_dump_index; //dump the trajectory of these spins
 
 	int m_diff_dimension;	// flag for 3-dimensional, 2-dim or 1-dim diffusion; default: 3-dim
-	void ProjectPosition(triple &pos, triple dir);
+	void ProjectPosition(triple &pos, triple dir, const triple &origin);
 
 	// variables for xml reader:
 	DOMTreeErrorReporter* 	m_domtree_error_rep;
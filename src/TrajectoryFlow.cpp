@@ -35,6 +35,7 @@
 //MODIF
 #include "World.h"
 #include "BinaryContext.h"
+#include "TrajectoryLog.h"
 //MODIF***
 
 #define CERR {cout<<"Error in flow trajectory file: "<< filename <<"; exit!"<<endl;exit(-1);}
@@ -43,6 +44,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstring>
 //#include <vector>
 //MODIF***
 
@@ -52,6 +54,18 @@ TrajectoryFlow::TrajectoryFlow() {
 	m_LastHuntIndexActivation=0;
 	m_trajLoopDuration=0;
 	m_trajLoopNumber=0;
+	m_traj_offset=NULL;
+	m_act_offset=NULL;
+	m_traj_time=NULL;
+	m_act_time=NULL;
+	m_trans_x_tab=NULL;
+	m_trans_y_tab=NULL;
+	m_trans_z_tab=NULL;
+	m_act_state=NULL;
+	m_indexed=false;
+	m_table_first=0;
+	m_table_size=0;
+	m_chunk=65536;
 //MODIF***
 
 }
@@ -68,14 +82,29 @@ void TrajectoryFlow::LoadFile(string filename) {
     std::size_t ext_pos = filename.rfind(".");
     std::size_t h5_pos = filename.rfind(".h5");
 
-    //Load file (HDF5 or ASCII)
-    if((h5_pos != string::npos) && (h5_pos == ext_pos))     LoadTrajectoriesHDF5(filename);
-    else                                                    LoadTrajectoriesASCII(filename);
+    //Indexed HDF5 file: trajectories are read per paket on demand
+    if((h5_pos != string::npos) && (h5_pos == ext_pos) && OpenIndexed(filename))
+        return;
 
-    //Get number of trajectories loaded
-    long siz_full=m_time_full.size();
-    m_TotalTrajNumber=siz_full;
+    //Parallel jemris: only the first slave of a node loads the file, the table is shared
     World *pW(World::instance());
+    bool shared = (pW->shareFunPtr != NULL);
+
+    //Load file (HDF5 or ASCII)
+    if (!shared || pW->m_node_rank == 0) {
+        if((h5_pos != string::npos) && (h5_pos == ext_pos))     LoadTrajectoriesHDF5(filename);
+        else                                                    LoadTrajectoriesASCII(filename);
+        BuildTable();
+    }
+
+    if (shared) {
+        size_t bytes = m_table.size();
+        const char* table = (const char*) pW->shareFunPtr(m_table.data(), bytes);
+        vector<char>().swap(m_table);
+        m_TotalTrajNumber = SetTable(table);
+    } else
+        m_TotalTrajNumber = SetTable(m_table.data());
+    m_table_size = m_TotalTrajNumber;
     //CAcout<<pW->m_myRank<<" number of trajectories loaded : "<<siz_full<<endl;
 
     //Optional: display the trajectories loaded
@@ -311,6 +340,144 @@ void TrajectoryFlow::LoadTrajectoriesHDF5(string filename) {
 }
 
 
+/***********************************************************/
+bool TrajectoryFlow::OpenIndexed(string filename) {
+
+    BinaryContext bc (filename, IO::IN);
+    if (bc.Status() != IO::OK)
+        {   cout << "Unable to open flow trajectories file: " << filename<< "; exit!"<<endl;exit(-1);    }
+
+    // legacy files have no index table
+    NDData<long> index;
+    size_t count = 1, total = 0;
+    if (bc.ReadSlab(index, "index", "/flow", 0, count, total) != IO::OK)
+        return false;
+    if (total < 2 || index.Size() != 2)
+        CERR;
+
+    World *pW(World::instance());
+    long Nspins = (pW->m_myRank<=0) ? pW->TotalSpinNumber : pW->getTrajNumber();
+
+    m_TotalTrajNumber = total-1;
+    if (Nspins > m_TotalTrajNumber) {
+        if(m_trajLoopDuration==0 && m_trajLoopNumber==0)   { cout<<"Flow file error. Insufficient number of trajectories in the input file."<<endl; CERR; }
+        if(m_trajLoopDuration==0)   { cout<<"Flow loop error. The loop duration was not specified."<<endl; CERR; }
+        if(m_trajLoopNumber==0)     { cout<<"Flow loop error. The number of trajectories in the loop was not specified."<<endl; CERR; }
+        if(m_trajLoopNumber>m_TotalTrajNumber)     { cout<<"Flow file error. Insufficient number of trajectories for the loop in the input file."<<endl; CERR; };
+        cout<<pW->m_myRank<<": flow loop activated on the last "<<m_trajLoopNumber<<" trajectories. Loop duration : "<<m_trajLoopDuration<<" ms"<<endl;
+    }
+
+    m_indexed     = true;
+    m_filename    = filename;
+    m_table_first = 0;
+    m_table_size  = 0;
+    vector<char>().swap(m_table);
+
+    return true;
+
+}
+
+/***********************************************************/
+void TrajectoryFlow::LoadChunk(long traj) {
+
+    string filename = m_filename;
+    World *pW(World::instance());
+
+    // trajectories are needed up to the end of the paket; beyond the end of the file the loop restarts
+    long n = m_chunk;
+    long paket_end = pW->getTrajBegin() + pW->getTrajPaket();
+    if (pW->getTrajPaket() > 0 && m_currentSpinIndex < paket_end && paket_end - m_currentSpinIndex < n)
+        n = paket_end - m_currentSpinIndex;
+    if (m_TotalTrajNumber - traj < n)
+        n = m_TotalTrajNumber - traj;
+
+    // rows of index: first sample and first activation state of a trajectory
+    BinaryContext bc (filename, IO::IN);
+    NDData<long>   index;
+    NDData<double> samples, activation;
+
+    size_t count = n+1, total = 0;
+    if (bc.ReadSlab(index, "index", "/flow", traj, count, total) != IO::OK || (long) count != n+1)
+        CERR;
+
+    size_t p0 = index[0], np = index[2*n] - p0;
+    size_t a0 = index[1], na = index[2*n+1] - a0;
+    if (np > 0 && (bc.ReadSlab(samples, "samples", "/flow", p0, np, total) != IO::OK || samples.Size() != 4*np || np != (size_t) index[2*n] - p0))
+        CERR;
+    if (na > 0 && (bc.ReadSlab(activation, "activation", "/flow", a0, na, total) != IO::OK || activation.Size() != 2*na || na != (size_t) index[2*n+1] - a0))
+        CERR;
+
+	SequenceTree* pSeqTree = pW->pSeqTree;
+	double seqDuration = pSeqTree->GetRootConcatSequence()->GetDuration();
+
+    m_time_full.resize(n);
+    m_trans_x_full.resize(n);
+    m_trans_y_full.resize(n);
+    m_trans_z_full.resize(n);
+    m_activation_full.resize(n);
+
+    for (long i=0; i<n; i++) {
+
+        vector<double>& t  = m_time_full[i];
+        vector<float>&  x  = m_trans_x_full[i];
+        vector<float>&  y  = m_trans_y_full[i];
+        vector<float>&  z  = m_trans_z_full[i];
+        vector<double>& at = m_activation_full[i].first;
+        vector<bool>&   as = m_activation_full[i].second;
+
+        for (long j=index[2*i]-p0; j<index[2*i+2]-(long)p0; j++) {
+            if (!t.empty() && samples[4*j+0] < t.back())
+                { cout<<"Trajectory error: decreasing time ("<<t.back()<<" and "<<samples[4*j+0]<<")."<<endl;CERR; }
+            t.push_back(samples[4*j+0]);
+            x.push_back(samples[4*j+1]);
+            y.push_back(samples[4*j+2]);
+            z.push_back(samples[4*j+3]);
+        }
+        for (long j=index[2*i+1]-a0; j<index[2*i+3]-(long)a0; j++) {
+            at.push_back(activation[2*j+0]);
+            as.push_back(activation[2*j+1] != 0.0);
+        }
+        if (t.empty())
+            { cout<<"Flow file error. Empty trajectory "<<traj+i<<"."<<endl; CERR; }
+
+        // spins without activation states are always active
+        if (at.empty())
+            { at.push_back(0.0); as.push_back(true); }
+
+        // input starts at t=0?
+        if (t[0] > 0) {
+            t.insert(t.begin(),0.0);
+            x.insert(x.begin(),x[0]);
+            y.insert(y.begin(),y[0]);
+            z.insert(z.begin(),z[0]);
+        }
+        if (at[0] > 0) {
+            at.insert(at.begin(),0.0);
+            as.insert(as.begin(),as[0]);
+        }
+
+        // data up to the end of trajectory?
+        if (t.back() < seqDuration) {
+            t.push_back(seqDuration + 1);
+            x.push_back(x.back());
+            y.push_back(y.back());
+            z.push_back(z.back());
+        }
+        if (at.back() < seqDuration) {
+            at.push_back(seqDuration + 1);
+            as.push_back(as.back());
+        }
+
+    }
+
+    // replaces the trajectories of the previous chunk
+    BuildTable();
+    SetTable(m_table.data());
+    m_table_first = traj;
+    m_table_size  = n;
+
+}
+
 /***********************************************************/
 void TrajectoryFlow::LoadTrajectoriesASCII(string filename)     {
 
@@ -482,23 +649,94 @@ void TrajectoryFlow::LoadTrajectoriesASCII(string filename)     {
 
 
 /***********************************************************/
-void TrajectoryFlow::GetPosition(double time, double &trans_x, double &trans_y, double &trans_z, long traj_number) {
+void TrajectoryFlow::BuildTable() {
+
+    long ntraj   = m_time_full.size();
+    long npoints = 0;
+    long nact    = 0;
+    for (long i=0; i<ntraj; i++) {
+        npoints += m_time_full[i].size();
+        nact    += m_activation_full[i].first.size();
+    }
+
+    // layout: header, offsets, time points, translations, activation states
+    size_t bytes = 3*sizeof(long) + 2*(ntraj+1)*sizeof(long) + (npoints+nact)*sizeof(double)
+                 + 3*npoints*sizeof(float) + nact*sizeof(char);
+    m_table.assign(bytes, 0);
+
+    long*   head  = (long*) m_table.data();
+    head[0] = ntraj; head[1] = npoints; head[2] = nact;
+    long*   toff  = head + 3;
+    long*   aoff  = toff + ntraj + 1;
+    double* t     = (double*) (aoff + ntraj + 1);
+    double* at    = t  + npoints;
+    float*  x     = (float*) (at + nact);
+    float*  y     = x  + npoints;
+    float*  z     = y  + npoints;
+    char*   as    = (char*) (z + npoints);
+
+    toff[0] = 0; aoff[0] = 0;
+    for (long i=0; i<ntraj; i++) {
+        long n = m_time_full[i].size();
+        memcpy (t + toff[i], m_time_full[i].data(),    n*sizeof(double));
+        memcpy (x + toff[i], m_trans_x_full[i].data(), n*sizeof(float));
+        memcpy (y + toff[i], m_trans_y_full[i].data(), n*sizeof(float));
+        memcpy (z + toff[i], m_trans_z_full[i].data(), n*sizeof(float));
+        toff[i+1] = toff[i] + n;
+        long m = m_activation_full[i].first.size();
+        memcpy (at + aoff[i], m_activation_full[i].first.data(), m*sizeof(double));
+        for (long j=0; j<m; j++)
+            as[aoff[i]+j] = m_activation_full[i].second[j];
+        aoff[i+1] = aoff[i] + m;
+    }
+
+    // free parsed data
+    vector< vector<double> >().swap(m_time_full);
+    vector< vector<float> >().swap(m_trans_x_full);
+    vector< vector<float> >().swap(m_trans_y_full);
+    vector< vector<float> >().swap(m_trans_z_full);
+    vector< pair< vector<double> , vector<bool> > >().swap(m_activation_full);
+
+}
+
+/***********************************************************/
+long TrajectoryFlow::SetTable(const char* table) {
+
+    const long* head  = (const long*) table;
+    long ntraj   = head[0];
+    long npoints = head[1];
+    long nact    = head[2];
 
+    m_traj_offset = head + 3;
+    m_act_offset  = m_traj_offset + ntraj + 1;
+    m_traj_time   = (const double*) (m_act_offset + ntraj + 1);
+    m_act_time    = m_traj_time + npoints;
+    m_trans_x_tab = (const float*) (m_act_time + nact);
+    m_trans_y_tab = m_trans_x_tab + npoints;
+    m_trans_z_tab = m_trans_y_tab + npoints;
+    m_act_state   = (const char*) (m_trans_z_tab + npoints);
 
-	int ilo = GetLowerIndex(time,m_time_full[traj_number],m_LastHuntIndex);
-	double step = m_time_full[traj_number][ilo+1] - m_time_full[traj_number][ilo];
-	double b = (time - m_time_full[traj_number][ilo])/step;
-   /* if(time==0) {
-        World *pW(World::instance());
-        int m_currentSpinIndex=pW->SpinNumber+pW->getTrajBegin();
-        cout<<pW->m_myRank<<" simulates spin "<<m_currentSpinIndex<<endl;
-    }*/
+    return ntraj;
+
+}
+
+/***********************************************************/
+void TrajectoryFlow::GetPosition(double time, double &trans_x, double &trans_y, double &trans_z, long traj_number) {
+
+	long o = m_traj_offset[traj_number];
+	const double* t = m_traj_time + o;
+	int ilo = HuntLowerIndex(time,t,m_traj_offset[traj_number+1]-o,m_LastHuntIndex);
+	double step = t[ilo+1] - t[ilo];
+	double b = (time - t[ilo])/step;
 
 	// linear interpolation:
 	//MODIF
-	trans_x = m_trans_x_full[traj_number][ilo] + ((m_trans_x_full[traj_number][ilo + 1] - m_trans_x_full[traj_number][ilo]) * b);
-	trans_y = m_trans_y_full[traj_number][ilo] + ((m_trans_y_full[traj_number][ilo + 1] - m_trans_y_full[traj_number][ilo]) * b);
-	trans_z = m_trans_z_full[traj_number][ilo] + ((m_trans_z_full[traj_number][ilo + 1] - m_trans_z_full[traj_number][ilo]) * b);
+	const float* x = m_trans_x_tab + o;
+	const float* y = m_trans_y_tab + o;
+	const float* z = m_trans_z_tab + o;
+	trans_x = x[ilo] + ((x[ilo + 1] - x[ilo]) * b);
+	trans_y = y[ilo] + ((y[ilo + 1] - y[ilo]) * b);
+	trans_z = z[ilo] + ((z[ilo + 1] - z[ilo]) * b);
     //MODIF***
 
 }
@@ -527,8 +765,13 @@ void TrajectoryFlow::GetValueDerived(double time,double *values)   {
         t_traj=time;
     }
 
+    //Indexed file: read the trajectory, unless it is in the table
+    if (m_indexed && (traj < m_table_first || traj >= m_table_first + m_table_size))
+        LoadChunk(traj);
+    long row = traj - m_table_first;
+
     //Get new position
-    GetPosition(t_traj, trans_x,trans_y,trans_z, traj);
+    GetPosition(t_traj, trans_x,trans_y,trans_z, row);
 
 	//Update new position
     	values[0] = trans_x;
@@ -536,68 +779,13 @@ void TrajectoryFlow::GetValueDerived(double time,double *values)   {
 	values[2] = trans_z;
 
     //Set spin activation
-    int ilo = GetLowerIndex(t_traj,m_activation_full[traj].first,m_LastHuntIndexActivation);
-    m_spinActive=m_activation_full[traj].second[ilo];
+    long o = m_act_offset[row];
+    double t_act = t_traj;
+    int ilo = HuntLowerIndex(t_act,m_act_time+o,m_act_offset[row+1]-o,m_LastHuntIndexActivation);
+    m_spinActive=m_act_state[o+ilo];
 
     //Log file
     if(World::instance()->logFile)
-    {
-        fstream log("FLOW.log",ios::out|ios::app);
-        log<<"spin "<<m_currentSpinIndex<<" time "<<time<<" t_traj "<<t_traj<<" trans_x "<<trans_x<<" trans_y "<<trans_y<<" trans_z "<<trans_z<<endl;
-        log.close();
-    }
-
-}
-
-
-
-/***********************************************************/
+        TrajectoryLog::instance()->Record(LOG_TRANSLATION, time, m_currentSpinIndex, values, m_spinActive, t_traj);
 
-int TrajectoryFlow::GetLowerIndex(double t, vector<double> timeArray, int LastHuntIndex) {
-	int ihi;
-	int ilo;
-
-	// test bounds:
-	if ((t<= timeArray[0]) || (t>=timeArray.back())) {
-		if (t == timeArray[0]) {ilo = 0;  return ilo;};
-		if (t == timeArray.back()) {ilo = timeArray.size()-2;  return ilo;};
-		cout << "Interpolation out of bounds! exit.(t= "<<t<<"; timeArray[0]="<<timeArray[0]<<"; timeArray.back()="<<timeArray.back()<< endl;
-		exit(-1);
-	}
-
-	// hunt phase:
-	int iHuntStep = 1;
-	int iend = timeArray.size()-1;
-
-	if (timeArray[LastHuntIndex]<t) {
-		// hunt up:
-		ilo = LastHuntIndex;
-		ihi = ilo + 1;
-		while (timeArray[ihi] < t ) {
-			ilo = ihi;
-			//iHuntStep << 1;
-			ihi = ilo + iHuntStep;
-			if (ihi > iend) ihi = iend;
-		}
-	} else {
-		// hunt down:
-		ihi = LastHuntIndex;
-		ilo = ihi - 1;
-		while (timeArray[ilo] > t ) {
-			ihi = ilo;
-			//iHuntStep << 1;
-			ilo = ihi - iHuntStep;
-			if (ilo < 0 ) ilo = 0;
-		}
-	}
-	// bisection phase:
-	int middle;
-	while ( (ihi-ilo) > 1) {
-		middle=(ihi+ilo) >> 1;
-		if (timeArray[middle] > t) ihi = middle; else ilo = middle;
-	}
-
-	LastHuntIndex = ilo;
-	return ilo;
 }
-/****************************************************************/
@@ -58,13 +58,39 @@ private:
 
 	void LoadTrajectoriesASCII(string filename);
 
-	void GetPosition(double time, double &trans_x, double &trans_y, double &trans_z, long traj_number);
+	/**
+	 * @brief Open a flow file with index table; no trajectory is read yet
+	 *
+	 * @return false, if the file has no index table
+	 */
+	bool OpenIndexed(string filename);
+
+	/**
+	 * @brief Read the next trajectories of the current paket from the indexed file
+	 *        into the table, replacing the previous ones
+	 *
+	 * @param traj First trajectory to read
+	 */
+	void LoadChunk(long traj);
+
+	/**
+	 * @brief Flatten the parsed trajectories into one table (and free the parsed data)
+	 */
+	void BuildTable();
+
+	/**
+	 * @brief Point the table members to a flattened table
+	 *
+	 * @return Number of trajectories in the table
+	 */
+	long SetTable(const char* table);
 
-    int GetLowerIndex(double t, vector<double> timeArray, int LastHuntIndex);
+	void GetPosition(double time, double &trans_x, double &trans_y, double &trans_z, long traj_number);
 
     int m_LastHuntIndexActivation;
 
-    long m_TotalTrajNumber;
+    // trajectories as parsed from file
+    vector< vector<double> > m_time_full;
 
     vector< pair< vector<double> , vector<bool> > > m_activation_full;
 
@@ -77,6 +103,24 @@ private:
 	vector<float> m_trans_x,m_trans_y,m_trans_z;
 	//vector<double> m_rot_x,m_rot_y,m_rot_z;
 
+    // flattened table; in parallel jemris shared by the slaves of a node
+    vector<char>   m_table;          /**< table memory, unless shared */
+    const long*    m_traj_offset;    /**< first sample of each trajectory (m_TotalTrajNumber+1) */
+    const long*    m_act_offset;     /**< first activation state of each trajectory (m_TotalTrajNumber+1) */
+    const double*  m_traj_time;      /**< time points of all trajectories */
+    const double*  m_act_time;       /**< activation time points of all trajectories */
+    const float*   m_trans_x_tab;    /**< x translation of all trajectories */
+    const float*   m_trans_y_tab;    /**< y translation of all trajectories */
+    const float*   m_trans_z_tab;    /**< z translation of all trajectories */
+    const char*    m_act_state;      /**< activation states of all trajectories */
+
+    // indexed HDF5 files are read lazily, a chunk of trajectories at a time
+    bool           m_indexed;        /**< trajectories are read from an indexed file on demand */
+    string         m_filename;       /**< indexed flow file */
+    long           m_table_first;    /**< first trajectory in the table */
+    long           m_table_size;     /**< number of trajectories in the table */
+    long           m_chunk;          /**< max. number of trajectories read at once */
+
 
 	//bool btx, bty, btz, brx, bry, brz;					/* flags==true: there is data!=0 on this axis  */
 
@@ -30,10 +30,16 @@
 
 #include "TrajectoryInterface.h"
 
+int TrajectoryInterface::m_bounds = BOUNDS_CLAMP;
+
 TrajectoryInterface::TrajectoryInterface() {
 	m_LastHuntIndex=0;
+	m_uniform=false;
+	m_grid_first=0;
+	m_grid_rdt=0.0;
 //MODIF
 	m_currentSpinIndex=0;
+	m_TotalTrajNumber=0;
 	m_trajLoopDuration=0;
 	m_trajLoopNumber=0;
 	m_spinActive=true;
@@ -44,40 +50,100 @@ TrajectoryInterface::~TrajectoryInterface() {
 }
 
 /***********************************************************/
+void TrajectoryInterface::SetupGrid() {
+
+	m_uniform       = false;
+	m_LastHuntIndex = 0;
+	long n = m_time.size();
+	if (n < 4) return;
+
+	// the loaders pad the data with t=0 and a point after the sequence end
+	int    first = 1;
+	int    last  = n-2;
+	double dt    = m_time[2] - m_time[1];
+	if (dt <= 0.0) return;
+	if (fabs(m_time[1] - m_time[0] - dt) <= 1e-9*dt) first = 0;
+	if (fabs(m_time[n-1] - m_time[n-2] - dt) <= 1e-9*dt) last = n-1;
+
+	for (int i=first+1; i<=last; i++)
+		if (fabs(m_time[i] - m_time[first] - (i-first)*dt) > 1e-6*dt)
+			return;
+
+	m_uniform    = true;
+	m_grid_first = first;
+	m_grid_rdt   = 1.0/dt;
+
+}
+
+/***********************************************************/
+int TrajectoryInterface::GetLowerIndex(double& t) {
+
+	long n = m_time.size();
+	if (!m_uniform || t <= m_time[0] || t >= m_time[n-1])
+		return HuntLowerIndex(t, &m_time[0], n, m_LastHuntIndex);
 
-int TrajectoryInterface::GetLowerIndex(double t) {
+	// uniform grid: index arithmetic, corrected at padded points and for rounding
+	long ilo = m_grid_first + (long) ((t - m_time[m_grid_first])*m_grid_rdt);
+	if (ilo < 0)   ilo = 0;
+	if (ilo > n-2) ilo = n-2;
+	while (ilo > 0   && m_time[ilo]   > t) ilo--;
+	while (ilo < n-2 && m_time[ilo+1] < t) ilo++;
+
+	return ilo;
+
+}
+
+/***********************************************************/
+int TrajectoryInterface::HuntLowerIndex(double& t, const double* timeArray, long n, int& hunt) {
 	int ihi;
 	int ilo;
 
 	// test bounds:
-	if ((t<= m_time[0]) || (t>=m_time.back())) {
-		if (t == m_time[0]) {ilo = 0;  return ilo;};
-		if (t == m_time.back()) {ilo = m_time.size()-2;  return ilo;};
-		cout << "Interpolation out of bounds! exit.(t= "<<t<<"; m_time[0]="<<m_time[0]<<"; m_time.back()="<<m_time.back()<< endl;
-		exit(-1);
+	if ((t<= timeArray[0]) || (t>=timeArray[n-1])) {
+		static bool warned = false;
+		bool below = (t < timeArray[0]);
+		bool above = (t > timeArray[n-1]);
+		if ((below || above) && !warned) {
+			cout << "Warning: interpolation out of bounds (t= "<<t<<"; timeArray[0]="<<timeArray[0]<<"; timeArray.back()="<<timeArray[n-1]<<"); "
+			     << ((m_bounds == BOUNDS_EXTRAPOLATE) ? "extrapolating" : "clamping") << endl;
+			warned = true;
+		}
+		if (below) {
+			double tmin = timeArray[0];
+			if (m_bounds == BOUNDS_EXTRAPOLATE) tmin -= timeArray[1] - timeArray[0];
+			if (t < tmin) t = tmin;
+		}
+		if (above) {
+			double tmax = timeArray[n-1];
+			if (m_bounds == BOUNDS_EXTRAPOLATE) tmax += timeArray[n-1] - timeArray[n-2];
+			if (t > tmax) t = tmax;
+		}
+		ilo = (t <= timeArray[0]) ? 0 : n-2;
+		return ilo;
 	}
 
 	// hunt phase:
 	int iHuntStep = 1;
-	int iend = m_time.size()-1;
+	int iend = n-1;
+	if (hunt < 0 || hunt > n-2) hunt = 0;
 
-	if (m_time[m_LastHuntIndex]<t) {
+	if (timeArray[hunt]<t) {
 		// hunt up:
-		ilo = m_LastHuntIndex;
+		ilo = hunt;
 		ihi = ilo + 1;
-		while (m_time[ihi] < t ) {
+		while (timeArray[ihi] < t ) {
 			ilo = ihi;
-			//iHuntStep << 1;
+			iHuntStep <<= 1;
 			ihi = ilo + iHuntStep;
 			if (ihi > iend) ihi = iend;
 		}
 	} else {
 		// hunt down:
-		ihi = m_LastHuntIndex;
+		ihi = hunt;
 		ilo = ihi - 1;
-		while (m_time[ilo] > t ) {
+		while (timeArray[ilo] > t ) {
 			ihi = ilo;
-			//iHuntStep << 1;
+			iHuntStep <<= 1;
 			ilo = ihi - iHuntStep;
 			if (ilo < 0 ) ilo = 0;
 		}
@@ -86,10 +152,10 @@ int TrajectoryInterface::GetLowerIndex(double t) {
 	int middle;
 	while ( (ihi-ilo) > 1) {
 		middle=(ihi+ilo) >> 1;
-		if (m_time[middle] > t) ihi = middle; else ilo = middle;
+		if (timeArray[middle] > t) ihi = middle; else ilo = middle;
 	}
 
-	m_LastHuntIndex = ilo;
+	hunt = ilo;
 	return ilo;
 }
 /****************************************************************/
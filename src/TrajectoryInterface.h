@@ -41,6 +41,14 @@
 
 using namespace std;
 
+/**
+ * @brief Policy for time points outside of a trajectory
+ */
+enum TrajectoryBounds {
+	BOUNDS_CLAMP       = 0, /**< hold the first / last value                            */
+	BOUNDS_EXTRAPOLATE = 1  /**< extrapolate linearly up to one interval, then hold it */
+};
+
 /**
  * @brief pure virtual base class for all Trajectories
  */
@@ -55,7 +63,7 @@ public:
 	 */
     inline
 	void GetValue(double time, double *value) {
-        if (m_time.size()>0 || m_time_full.size()>0)    //MODIF
+        if (m_time.size()>0 || m_TotalTrajNumber>0)    //MODIF
             GetValueDerived(time,value);
     }
 
@@ -93,18 +101,46 @@ public:
 	void setLoop(double loopDuration, long loopTrajNumber) { m_trajLoopNumber=loopTrajNumber; m_trajLoopDuration=loopDuration; };
 //MODIF***
 
+	/**
+	 * @brief set the policy for time points outside of all trajectories
+	 */
+	static void SetBounds(int bounds) { m_bounds = bounds; };
+
 protected:
 	/**
 	 * @brief find data index for interpolation
-	 * get lower index for given timepoint using hunt search algorithm.
+	 * get lower index for given timepoint: direct on uniform time grids, else by hunt search.
+	 * Time points outside of the trajectory are moved according to the bounds policy.
 	 */
-	int GetLowerIndex(double time);
+	int GetLowerIndex(double& time);
+
+	/**
+	 * @brief hunt search of the lower index in any time array
+	 *
+	 * @param time      time point; moved according to the bounds policy
+	 * @param timeArray time points of the trajectory
+	 * @param n         number of time points (at least 2)
+	 * @param hunt      start of the search; updated
+	 */
+	static int HuntLowerIndex(double& time, const double* timeArray, long n, int& hunt);
+
+	/**
+	 * @brief check whether m_time is a uniform grid (apart from padded first and last points)
+	 * to be called whenever m_time changes
+	 */
+	void SetupGrid();
 
 	int m_LastHuntIndex;
 
+	bool   m_uniform;     /**< m_time is uniform from m_grid_first on */
+	int    m_grid_first;  /**< first point of the uniform grid */
+	double m_grid_rdt;    /**< inverse interval of the uniform grid */
+
+	static int m_bounds;  /**< TrajectoryBounds policy */
+
 	vector<double> m_time;
 //MODIF
-	vector< vector<double> > m_time_full;
+	long m_TotalTrajNumber;
 
 	long m_currentSpinIndex;
 
@@ -0,0 +1,169 @@
+/** @file TrajectoryLog.cpp
+ *  @brief Implementation of JEMRIS TrajectoryLog
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TrajectoryLog.h"
+#include "World.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <chrono>
+
+TrajectoryLog* TrajectoryLog::m_instance = 0;
+
+static const size_t LOG_RING_SIZE = 65536;
+
+/***********************************************************/
+TrajectoryLog* TrajectoryLog::instance () {
+
+	if (m_instance == 0) {
+		m_instance = new TrajectoryLog();
+		atexit(TrajectoryLog::Close);
+	}
+
+	return m_instance;
+
+}
+
+/***********************************************************/
+TrajectoryLog::TrajectoryLog () {
+
+	World* pW  = World::instance();
+
+	m_stop     = false;
+	m_head     = 0;
+	m_count    = 0;
+	m_interval = pW->logInterval;
+	m_ring.resize(LOG_RING_SIZE);
+	for (int i = 0; i < 3; i++) {
+		m_last_spin[i]   = -1;
+		m_last_sample[i] = -1;
+	}
+
+	stringstream name;
+	name << "trajectories";
+	if (pW->m_myRank >= 0)
+		name << "_" << pW->m_myRank;
+	name << ".bin";
+	m_file.open(name.str().c_str(), ios::binary | ios::trunc);
+	if (!m_file.is_open())
+		cout << "Warning: unable to open trajectory log " << name.str() << endl;
+
+	m_thread   = std::thread(&TrajectoryLog::Run, this);
+
+}
+
+/***********************************************************/
+void TrajectoryLog::Close () {
+
+	if (m_instance == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_instance->m_mutex);
+		m_instance->m_stop = true;
+	}
+	m_instance->m_cond.notify_one();
+	m_instance->m_thread.join();
+	m_instance->m_file.close();
+
+	delete m_instance;
+	m_instance = 0;
+
+}
+
+/***********************************************************/
+void TrajectoryLog::Record (int kind, double time, long spin, const double* value, bool active, double extra) {
+
+	LogRecord r;
+	r.time     = time;
+	r.value[0] = value[0];
+	r.value[1] = value[1];
+	r.value[2] = value[2];
+	r.value[3] = extra;
+	r.spin     = spin;
+	r.kind     = kind;
+	r.active   = active;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// first evaluation of the spin in this sampling interval?
+	long sample = (m_interval > 0.0) ? (long) floor(time/m_interval) : -1;
+	if (m_interval > 0.0 && spin == m_last_spin[kind] && sample == m_last_sample[kind])
+		return;
+	m_last_spin[kind]   = spin;
+	m_last_sample[kind] = sample;
+
+	while (m_count == m_ring.size())
+		m_space.wait(lock);
+	m_ring[(m_head + m_count) % m_ring.size()] = r;
+	m_count++;
+
+	// wake the I/O thread, once a quarter of the buffer is filled
+	if (m_count == m_ring.size()/4)
+		m_cond.notify_one();
+
+}
+
+/***********************************************************/
+void TrajectoryLog::Run () {
+
+	for (;;) {
+
+		size_t head, n;
+		bool   stop;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, std::chrono::seconds(1), [this]{ return m_stop || m_count >= m_ring.size()/4; });
+			head = m_head;
+			n    = m_count;
+			stop = m_stop;
+		}
+
+		// the records [head, head+n) are not touched by the simulation until released
+		size_t first = m_ring.size() - head;
+		if (first > n)
+			first = n;
+		if (m_file.is_open()) {
+			m_file.write((const char*) &m_ring[head], first * sizeof(LogRecord));
+			m_file.write((const char*) &m_ring[0],    (n - first) * sizeof(LogRecord));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_head   = (m_head + n) % m_ring.size();
+			m_count -= n;
+		}
+		m_space.notify_all();
+
+		if (stop && n == 0)
+			break;
+
+	}
+
+	m_file.flush();
+
+}
@@ -0,0 +1,134 @@
+/** @file TrajectoryLog.h
+ *  @brief Implementation of JEMRIS TrajectoryLog
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TRAJECTORYLOG_H_
+#define TRAJECTORYLOG_H_
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * @brief Kind of a trajectory log record
+ */
+enum LogKind {
+	LOG_POSITION    = 0, /**< spin position before flow               */
+	LOG_FLOW        = 1, /**< spin position after flow                */
+	LOG_TRANSLATION = 2  /**< flow translation; value[3]: trajectory time */
+};
+
+/**
+ * @brief Record of the trajectory log (48 bytes)
+ */
+struct LogRecord {
+	double time;      /**< simulation time [ms]             */
+	double value[4];  /**< position or translation [mm], ... */
+	int    spin;      /**< spin (trajectory) number         */
+	short  kind;      /**< LogKind                          */
+	short  active;    /**< spin activation                  */
+};
+
+/**
+ * @brief Binary log of spin trajectories, written by a background thread
+ *
+ * Records are appended to a ring buffer; the I/O thread drains it into
+ * trajectories.bin (trajectories_<rank>.bin in parallel jemris), a plain
+ * sequence of LogRecord. Only the first evaluation of a spin per sampling
+ * interval is recorded for each kind, since the ODE solver evaluates the
+ * trajectories many times per time step. The simulation waits only if the
+ * ring buffer is full.
+ *
+ * Logging is switched on by logActivation.txt: logFile, logTrajectories and
+ * optionally the sampling interval in ms (default 0: every evaluation).
+ */
+class TrajectoryLog {
+
+ public:
+
+	/**
+	 * @brief Get sole instance
+	 */
+	static TrajectoryLog* instance ();
+
+	/**
+	 * @brief Record a spin position or translation
+	 *
+	 * @param kind    LogKind
+	 * @param time    Simulation time [ms]
+	 * @param spin    Spin (trajectory) number
+	 * @param value   Position or translation
+	 * @param active  Spin activation
+	 * @param extra   Fourth value of the record
+	 */
+	void        Record  (int kind, double time, long spin, const double* value, bool active, double extra = 0.0);
+
+	/**
+	 * @brief Write all records and stop the I/O thread
+	 */
+	static void Close   ();
+
+ private:
+
+	/**
+	 * @brief Constructor, private for singleton
+	 */
+	TrajectoryLog ();
+
+	/**
+	 * @brief Destructor
+	 */
+	~TrajectoryLog () {};
+
+	/**
+	 * @brief I/O thread
+	 */
+	void        Run     ();
+
+	static TrajectoryLog*   m_instance; /**< Sole instance                      */
+
+	std::thread             m_thread;   /**< I/O thread                         */
+	std::mutex              m_mutex;    /**< Guards the ring buffer and m_stop  */
+	std::condition_variable m_cond;     /**< Wakes the I/O thread               */
+	std::condition_variable m_space;    /**< Wakes a writer of a full buffer    */
+	bool                    m_stop;     /**< Stop the I/O thread                */
+
+	vector<LogRecord>       m_ring;     /**< Ring buffer                        */
+	size_t                  m_head;     /**< Next record to write to file       */
+	size_t                  m_count;    /**< Records in the ring buffer         */
+	ofstream                m_file;     /**< Log file                           */
+
+	double                  m_interval; /**< Sampling interval [ms]             */
+	long                    m_last_spin[3];   /**< Last recorded spin per kind     */
+	long                    m_last_sample[3]; /**< Last recorded interval per kind */
+
+};
+
+#endif /*TRAJECTORYLOG_H_*/
@@ -110,6 +110,7 @@ void TrajectoryMotion::LoadFile(string filename) {
     	m_rot_y.push_back(m_rot_y.back());
     	m_rot_z.push_back(m_rot_z.back());
     }
+    SetupGrid();
 
     // test if motion is zero for a whole axis:
     btx = false;bty = false;btz = false;brx = false;bry = false;brz = false;
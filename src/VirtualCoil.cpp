@@ -0,0 +1,81 @@
+/** @file VirtualCoil.cpp
+ *  @brief Implementation of JEMRIS VirtualCoil
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "VirtualCoil.h"
+
+/***********************************************************/
+VirtualCoil::VirtualCoil (const vector<Coil*>& coils, const std::complex<double>* weights) {
+
+	const Coil* grid = coils[0];
+
+	m_signal      = NULL;
+	m_mode        = RX;
+	m_position[XC]= 0.0;
+	m_position[YC]= 0.0;
+	m_position[ZC]= 0.0;
+	m_azimuth     = 0.0;
+	m_polar       = 0.0;
+	m_scale       = 1.0;
+	m_norm        = 1.0;
+	m_phase       = 0.0;
+	m_weight[0]   = 1.0;
+	m_weight[1]   = 0.0;
+	m_interpolate = true;
+	m_complex     = true;
+	m_conjugate   = false;
+	m_dim         = grid->m_dim;
+	m_extent      = grid->m_extent;
+	m_points      = grid->m_points;
+
+	int nz = (m_dim==3?m_points:1);
+	m_sensmag = NDData<double> (m_points, m_points, nz);
+	m_senspha = NDData<double> (m_points, m_points, nz);
+
+	// the interpolated sensitivity of a coil is its weight scale*exp(i*phase) times its (conjugated) map
+	vector< std::complex<double> > w (coils.size());
+	for (unsigned int c=0; c<coils.size(); c++)
+		w[c] = weights[c] * std::complex<double>(coils[c]->m_weight[0], coils[c]->m_weight[1]);
+
+	double mx = 0.0;
+	for (int k=0; k<nz; k++)
+		for (int j=0; j<m_points; j++)
+			for (int i=0; i<m_points; i++) {
+				size_t b = 2*grid->Brick(i,j,k);
+				std::complex<double> v = 0.0;
+				for (unsigned int c=0; c<coils.size(); c++) {
+					const double* map = &coils[c]->m_cplx[b];
+					v += w[c] * std::complex<double>(map[0], (coils[c]->m_conjugate?-1.0:1.0) * map[1]);
+				}
+				m_sensmag(i,j,k) = abs(v);
+				m_senspha(i,j,k) = arg(v);
+				mx = (mx>m_sensmag(i,j,k)?mx:m_sensmag(i,j,k));
+			}
+
+	m_norm = (mx>0.0?1/mx:1.0);
+	BuildComplexMap();
+	ReleaseMaps();
+
+}
@@ -0,0 +1,91 @@
+/** @file VirtualCoil.h
+ *  @brief Implementation of JEMRIS VirtualCoil
+ */
+
+/*
+ *  JEMRIS Copyright (C) 
+ *                        2006-2025  Tony Stoecker
+ *                        2007-2018  Kaveh Vahedipour
+ *                        2009-2019  Daniel Pflugfelder
+ *                                  
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef VIRTUALCOIL_H_
+#define VIRTUALCOIL_H_
+
+#include "Coil.h"
+
+#include <complex>
+
+/**
+ * @brief Virtual coil of a compressed receive array
+ *
+ * The sensitivity of a virtual coil is a linear combination of the
+ * sensitivities of the physical coils. Its map is computed once on the
+ * common grid of the physical coils; as the interpolation is linear, it
+ * equals the combination of the interpolated physical sensitivities.
+ */
+class VirtualCoil : public Coil {
+
+ public:
+
+    /**
+     * @brief Construct from the physical coils
+     *
+     * The physical coils have to interpolate their maps on the same grid.
+     *
+     * @param coils   Physical coils
+     * @param weights Weight of each physical coil
+     */
+	VirtualCoil (const vector<Coil*>& coils, const std::complex<double>* weights);
+
+	/**
+	 * @brief Default destructor
+	 */
+	~VirtualCoil () {};
+
+	/**
+	 * @brief  Clone a virtual coil
+	 *
+	 * @return Cloned virtual coil
+	 */
+	inline virtual VirtualCoil* Clone() const { return (new VirtualCoil(*this)); };
+
+	/**
+	 * @brief Get sensitivity
+	 *
+	 * @param  position Spin position.
+	 * @return Interpolated magnitude of the combined map.
+	 */
+	virtual double GetSensitivity (const double* position) { return InterpolateSensitivity(position); };
+
+	/**
+	 * @brief Get phase
+	 *
+	 * @param  position Spin position.
+	 * @return Interpolated phase of the combined map.
+	 */
+	virtual double GetPhase (const double* position) { return InterpolateSensitivity(position,false); };
+
+	/**
+	 * @brief Virtual coils are not configured by XML
+	 */
+	virtual bool Prepare (const PrepareMode mode) { return true; };
+
+};
+
+#endif /*VIRTUALCOIL_H_*/
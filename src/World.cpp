@@ -27,6 +27,7 @@
 #include "World.h"
 #include "Model.h"
 #include "SequenceTree.h"
+#include "DynamicVariables.h"
 
 World* World::m_instance = 0;
 
@@ -42,15 +43,19 @@ World* World::instance() {
         if(logAct.is_open())	{
 		logAct>>m_instance->logFile;
 		logAct>>m_instance->logTrajectories;
+		if (!(logAct>>m_instance->logInterval))
+			m_instance->logInterval = 0.0;
 	}
 	else
 	{
 		m_instance->logFile 	    = 0;
 		m_instance->logTrajectories = 0;
+		m_instance->logInterval     = 0.0;
 	}
         logAct.close();
         m_instance->m_trajBegin         =  0;
         m_instance->m_trajSize          =  1;
+        m_instance->m_trajPaket         =  0;
         //MODIF***
         m_instance->time                =  0.0;
         m_instance->total_time          =  0.0;
@@ -58,12 +63,16 @@ World* World::instance() {
         m_instance->deltaB              =  0.0;
         m_instance->GMAXoverB0          =  0.0;
         m_instance->NonLinGradField     =  0.0;
+        m_instance->m_pos_spin          = -1;
+        m_instance->m_pos_time          =  0.0;
         m_instance->LargestM0           =  0.0;
         m_instance->RandNoise           =  0.0;
+        m_instance->m_seed              =  42;
         m_instance->saveEvolStepSize    =  0;
         m_instance->saveEvolFileName    =  "";
         m_instance->saveEvolOfstream    = NULL;
         m_instance->saveEvolFunPtr      = &Model::saveEvolution;
+        m_instance->shareFunPtr         = NULL;
         m_instance->solverSuccess       = true;
         m_instance->m_noofspinprops     = 9;
 
@@ -74,6 +83,8 @@ World* World::instance() {
         m_instance->m_myRank            = -1;
         m_instance->m_useLoadBalancing  = true;
         m_instance->m_no_processes      = 1;  /* default: serial jemris */
+        m_instance->m_node_rank         = -1;
+        m_instance->m_checkpointInterval = 300.0;
         m_instance->m_startSpin         = 0;
 
         m_instance->m_slice             = 0;
@@ -105,6 +116,33 @@ double World::ConcomitantField (double* G) {
 
 }
 
+/***********************************************************/
+void World::SpinPosition (double time, double* position) {
+
+	if (m_pos_spin != SpinNumber || m_pos_time != time) {
+
+		DynamicVariables* dv = DynamicVariables::instance();
+
+		m_pos[XC] = Values[XC];
+		m_pos[YC] = Values[YC];
+		m_pos[ZC] = Values[ZC];
+
+		dv->m_Diffusion->GetValue(time, m_pos);
+		dv->m_Flow->GetValue(time, m_pos, getTrajBegin()+SpinNumber);
+		dv->m_Respiration->GetValue(time, m_pos);
+		dv->m_Motion->GetValue(time, m_pos);
+
+		m_pos_spin = SpinNumber;
+		m_pos_time = time;
+
+	}
+
+	position[XC] = m_pos[XC];
+	position[YC] = m_pos[YC];
+	position[ZC] = m_pos[ZC];
+
+}
+
 /***********************************************************/
 void World::SetNoOfSpinProps (int n) { 
 
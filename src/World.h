@@ -64,11 +64,20 @@ class World {
       */
 	bool logTrajectories;
 
+     /**
+      * @brief Sampling interval of the trajectory log [ms] (0: every evaluation)
+      */
+	double logInterval;
+
 
     /**
       * @brief Set trajectory parameters for MPI current sample paket
+      *
+      * @param firstSpin  First spin of the paket
+      * @param paketSize  Number of trajectories to load
+      * @param paketSpins Number of spins of the paket (0: unknown)
       */
-	void setTrajLoading(int firstSpin, int paketSize)  { m_trajBegin=firstSpin; m_trajSize=paketSize; };
+	void setTrajLoading(int firstSpin, int paketSize, long paketSpins = 0)  { m_trajBegin=firstSpin; m_trajSize=paketSize; m_trajPaket=paketSpins; };
 
 
      /**
@@ -77,6 +86,8 @@ class World {
 	long getTrajBegin() { return m_trajBegin; };
 
 	long getTrajNumber() { return m_trajSize; };
+
+	long getTrajPaket() { return m_trajPaket; };
  //MODIF***
 
 
@@ -98,6 +109,21 @@ class World {
      */
     double ConcomitantField (double* G);
 
+    /**
+     * @brief    Position of the current spin at a time point, moved by diffusion, flow,
+     *           respiration and motion. The last time point is cached, such that the
+     *           trajectories are evaluated once for the Bloch equations and all coils.
+     *
+     * @param  time      Absolute time
+     * @param  position  Position of the spin
+     */
+    void   SpinPosition (double time, double* position);
+
+    /**
+     * @brief    Forget the cached spin position (e.g. new diffusion trajectory)
+     */
+    void   ResetSpinPosition () { m_pos_spin = -1; };
+
 	/**
 	 * @brief    Set number of spinproperties
 	 *
@@ -153,6 +179,16 @@ class World {
      */
     void      (*saveEvolFunPtr)(long l, bool b)  ;
 
+	/**
+     * @brief Pointer to the function placing read-only data in memory shared by the processes of a node
+     *        (parallel jemris only; NULL: every process keeps its own copy)
+     *
+     * @param data  Data to share (read on the first process of the node only)
+     * @param bytes Size of the data; set to the size of the shared data on the other processes
+     * @return      Pointer to the shared data
+     */
+    const void* (*shareFunPtr)(const void* data, size_t& bytes);
+
     void*             solverSettings ;      /**< @brief Arbitrary solver settings  */
     bool              solverSuccess;	    /**< @brief true, if last calculation successful */
 
@@ -172,8 +208,12 @@ class World {
     std::vector<double> solution;           /**< @brief Solution [M_r, phi, M_z] at the current time point*/
     double            LargestM0;            /**< @brief largest equilibrium magnetization for noise scaling*/
     double            RandNoise;            /**< @brief percentage of random noise added to the signal */
+    unsigned long     m_seed;               /**< @brief key of the counter-based random numbers (noise, isochromats); 42 unless set, repeatable */
     double            GMAXoverB0;           /**< @brief Constant for the concomitant field term */
     double            NonLinGradField;      /**< @brief Non-linear contribution to B_z from gradients */
+    long              m_pos_spin;           /**< @brief Spin of the cached position (-1: none) */
+    double            m_pos_time;           /**< @brief Time point of the cached position */
+    double            m_pos[3];             /**< @brief Cached position of the current spin */
 
     //members for the current sequence
     SequenceTree*     pSeqTree;             /**< @brief The main sequence tree*/
@@ -188,10 +228,13 @@ class World {
     int 			  m_myRank;				/**< @brief MPI rank of this process. if m_myRank<0 process is serial jemris */
     bool			  m_useLoadBalancing;	/**< @brief use load balancing (send sample in small packages top slaves) */
     int				  m_no_processes;		/**< @brief number of parallel processes; used by load balancing */
+    int				  m_node_rank;			/**< @brief rank among the processes of a node sharing memory (-1: no sharing) */
+    double			  m_checkpointInterval;	/**< @brief minimal time [s] between two restart checkpoints of a slave; apart from these, signals are reduced once at the end */
 
     //MODIF
     long              m_trajBegin;          /**< @brief First trajectory to load for current MPI sample paket */
     long              m_trajSize;           /**< @brief Number of trajectories to load for current MPI sample paket */
+    long              m_trajPaket;          /**< @brief Number of spins of the current MPI sample paket (0: unknown) */
     //MODIF***
 
     long			  m_startSpin;			/**< @brief start calculation with this spin ( in case of restart)  */
@@ -35,6 +35,12 @@ using namespace std;
 #define MPICH_IGNORE_CXX_SEEK
 
 #include <mpi.h>
+#if defined(OPEN_MPI) && OPEN_MPI
+	#include <mpi-ext.h>  // ULFM fault tolerance extension (MPIX_...)
+#endif
+#include <unistd.h>
+#include <algorithm>
+#include <ctime>
 
 #include "Signal.h"
 #include "Declarations.h"
@@ -46,7 +52,266 @@ using namespace std;
 #endif
 
 void mpi_send_paket_signal(Signal* pSig,int CoilID);
-void mpi_recv_paket_signal(Signal* pSig,int SlaveID,int CoilID);
+void mpi_recv_paket_signal(Signal* pSig,int SlaveID,int CoilID,bool add=true);
+void mpi_reduce_signals(CoilArray* RxCA);
+
+/**
+ * Control messages sent by the slaves to the master (tag REQUEST_SPINS):
+ * {rank, PAKET_REQUEST, 0} asks for the next paket,
+ * {rank, PAKET_SIGNAL, n} announces a restart checkpoint: the signal accumulated over the last n pakets,
+ * {rank, PAKET_HEARTBEAT, 0} is sent every HEARTBEAT_INTERVAL while the slave has pakets,
+ * {rank, PAKET_DONE, 0} is the last message of a slave, after it received its final paket.
+ */
+enum PaketMessage { PAKET_REQUEST, PAKET_SIGNAL, PAKET_HEARTBEAT, PAKET_DONE };
+
+#ifdef HAVE_MPI_THREADS
+/**
+ * Time [s] between two heartbeats of a slave
+ */
+#define HEARTBEAT_INTERVAL 10.0
+
+/**
+ * Time [s] without any message after which the master considers a slave lost.
+ * Its pakets since the last restart checkpoint are simulated again by the remaining slaves.
+ * A lost slave which stays silent for this time once more is given up.
+ */
+#define WORKER_TIMEOUT 120.0
+#else
+/**
+ * Without threads, slaves are only heard of between their pakets:
+ * minimal time [s] without a paket request after which the master considers a working slave lost
+ * (at least ten times the paket interval of the sample).
+ */
+#define WORKER_TIMEOUT 900.0
+#endif
+
+/**
+ * State of a slave at the master.
+ * Parked slaves requested a paket when none was left; they are answered when all slaves are parked,
+ * or with the pakets of a lost slave. Done and dismissed slaves got their final paket and are
+ * expected to report PAKET_DONE; closed slaves are accounted for (reported, failed or given up).
+ */
+enum SlaveState { SLAVE_WORKING, SLAVE_PARKED, SLAVE_DONE, SLAVE_LOST, SLAVE_DISMISSED, SLAVE_CLOSED };
+
+/**
+ * Begin spin of the final (empty) paket: tells a slave how its signal is collected.
+ * END_REDUCE: collectively by mpi_reduce_signals; END_GATHER: point-to-point, as slaves were lost;
+ * END_DISMISSED: the slave was considered lost, its signal is simulated by others and is discarded.
+ */
+enum PaketEnd { END_REDUCE = -1, END_GATHER = -2, END_DISMISSED = -3 };
+
+static int              s_paket_end = END_REDUCE; /**< how the signals are collected          */
+static std::vector<int> s_gather;                 /**< master: slaves which send their signal */
+
+/**
+ * Slaves were lost in this run: collectives on MPI_COMM_WORLD would not complete
+ */
+inline bool mpi_slaves_lost () { return s_paket_end != END_REDUCE; }
+
+#ifdef HAVE_MPI_THREADS
+/**
+ * Heartbeat of a slave, sent by an extra thread while the main thread simulates
+ */
+struct Heartbeat {
+	pthread_t       thread;   /**< sending thread              */
+	pthread_mutex_t lock;     /**< guards stop                 */
+	pthread_cond_t  cond;     /**< wakes the thread to stop it */
+	bool            stop;     /**< thread shall stop           */
+	int             rank;     /**< rank of this slave          */
+};
+
+static Heartbeat s_heartbeat = {pthread_t(), PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, 0};
+
+/*****************************************************************************/
+void* mpi_heartbeat (void* arg) {
+
+	int ctrl[3] = {s_heartbeat.rank, PAKET_HEARTBEAT, 0};
+
+	pthread_mutex_lock(&s_heartbeat.lock);
+	while (!s_heartbeat.stop) {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += (time_t) HEARTBEAT_INTERVAL;
+		pthread_cond_timedwait(&s_heartbeat.cond, &s_heartbeat.lock, &ts);
+		if (s_heartbeat.stop)
+			break;
+		pthread_mutex_unlock(&s_heartbeat.lock);
+		MPI_Send(ctrl,3,MPI_INT,0,REQUEST_SPINS,MPI_COMM_WORLD);
+		pthread_mutex_lock(&s_heartbeat.lock);
+	}
+	pthread_mutex_unlock(&s_heartbeat.lock);
+
+	return NULL;
+
+}
+#endif
+
+/*****************************************************************************/
+/**
+ *  start the heartbeat of a slave
+ */
+void mpi_start_heartbeat () {
+
+#ifdef HAVE_MPI_THREADS
+	s_heartbeat.stop = false;
+	s_heartbeat.rank = World::instance()->m_myRank;
+	if (pthread_create(&s_heartbeat.thread, NULL, mpi_heartbeat, NULL)) {
+		cout << "thread creation failed !! exit."<< endl;
+		exit (-1);
+	}
+#endif
+
+}
+
+/*****************************************************************************/
+/**
+ *  stop the heartbeat of a slave and send its last message
+ */
+void mpi_stop_heartbeat () {
+
+#ifdef HAVE_MPI_THREADS
+	pthread_mutex_lock(&s_heartbeat.lock);
+	s_heartbeat.stop = true;
+	pthread_cond_signal(&s_heartbeat.cond);
+	pthread_mutex_unlock(&s_heartbeat.lock);
+	pthread_join(s_heartbeat.thread, NULL);
+#endif
+
+	int ctrl[3] = {World::instance()->m_myRank, PAKET_DONE, 0};
+	MPI_Send(ctrl,3,MPI_INT,0,REQUEST_SPINS,MPI_COMM_WORLD);
+
+}
+
+/**
+ * Next paket of a slave, requested while the current paket is simulated.
+ */
+struct PaketPrefetch {
+	MPI_Request         req[4];   /**< request, no of spins, begin spin, spin data */
+	int                 ctrl[3];  /**< control message of the request             */
+	int                 nospins;  /**< no of spins in the paket                   */
+	long                begin;    /**< first spin of the paket                    */
+	std::vector<double> data;     /**< spin data (unless generated locally)       */
+	int                 maxpaket; /**< maximal paket size                         */
+	int                 pakets;   /**< pakets simulated since the last checkpoint */
+	double              lastdump; /**< time of the last checkpoint                */
+};
+
+static PaketPrefetch s_prefetch;
+
+/**
+ * Hybrid mode: the master process simulates spins too, while the paket distribution
+ * runs on an extra thread. The lock guards the master sample and signal shared by both.
+ */
+#ifdef HAVE_MPI_THREADS
+struct MasterShare {
+	pthread_mutex_t lock;     /**< guards sample bookkeeping and master signal   */
+	pthread_cond_t  cond;     /**< signals that the initial pakets are scattered */
+	bool            ready;    /**< initial pakets are scattered                  */
+};
+
+static MasterShare s_master = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false};
+
+inline void master_lock   () { pthread_mutex_lock  (&s_master.lock); }
+inline void master_unlock () { pthread_mutex_unlock(&s_master.lock); }
+#else
+inline void master_lock   () {}
+inline void master_unlock () {}
+#endif
+
+/**
+ * Read-only data shared by the slaves of a node (MPI-3 shared memory windows)
+ */
+static MPI_Comm             s_node_comm = MPI_COMM_NULL;
+static std::vector<MPI_Win> s_shared_windows;
+
+/*****************************************************************************/
+/**
+ *  place data in a shared memory window of the node (collective on the slaves of the node);
+ *  the first slave of the node provides the data, the others read its copy
+ */
+const void* mpi_share_on_node (const void* data, size_t& bytes) {
+
+#if MPI_VERSION >= 3
+	bool     owner = (World::instance()->m_node_rank == 0);
+	MPI_Aint size  = owner ? (MPI_Aint) bytes : 0;
+	void*    base;
+	MPI_Win  win;
+
+	MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, s_node_comm, &base, &win);
+	if (owner && bytes > 0)
+		memcpy (base, data, bytes);
+	MPI_Win_fence(0, win);
+
+	if (!owner) {
+		int disp;
+		MPI_Win_shared_query(win, 0, &size, &disp, &base);
+		bytes = (size_t) size;
+	}
+
+	s_shared_windows.push_back(win);
+	return base;
+#else
+	return data;
+#endif
+
+}
+
+/*****************************************************************************/
+/**
+ *  group the slaves by node for sharing read-only data (collective on all processes)
+ */
+void mpi_init_node_sharing () {
+
+#if MPI_VERSION >= 3
+	World*   pW = World::instance();
+	MPI_Comm slaves;
+
+	MPI_Comm_split(MPI_COMM_WORLD, (pW->m_myRank == 0) ? MPI_UNDEFINED : 0, pW->m_myRank, &slaves);
+	if (slaves == MPI_COMM_NULL)
+		return;
+
+	MPI_Comm_split_type(slaves, MPI_COMM_TYPE_SHARED, pW->m_myRank, MPI_INFO_NULL, &s_node_comm);
+	MPI_Comm_free(&slaves);
+	MPI_Comm_rank(s_node_comm, &pW->m_node_rank);
+	pW->shareFunPtr = &mpi_share_on_node;
+#endif
+
+}
+
+/*****************************************************************************/
+/**
+ *  release the node-shared data (after the simulation)
+ */
+void mpi_free_node_sharing () {
+
+#if MPI_VERSION >= 3
+	for (unsigned int i=0; i < s_shared_windows.size(); i++)
+		MPI_Win_free(&s_shared_windows[i]);
+	s_shared_windows.clear();
+	if (s_node_comm != MPI_COMM_NULL)
+		MPI_Comm_free(&s_node_comm);
+#endif
+
+}
+
+/*****************************************************************************/
+/**
+ *  send the compression matrix of the receive array from the master to the slaves (collective)
+ */
+void mpi_bcast_compression (CoilArray* RxCA) {
+
+	std::vector< std::complex<double> > A = RxCA->GetCompression();
+	int n = A.size();
+
+	MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (n == 0)
+		return;
+
+	A.resize(n);
+	MPI_Bcast(&A[0], 2*n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	RxCA->SetCompression(A);
+
+}
 
 /*****************************************************************************/
 inline MPI_Datatype MPIspindata () {
@@ -83,12 +348,15 @@ void* CountProgress(void * arg) {
 
 	MPI_Status status;
 
-	while (SpinsDone != TotalNoSpins) {
-	  MPI_Recv(&NowDone,1,MPI_INT,MPI_ANY_SOURCE,SPINS_PROGRESS,MPI_COMM_WORLD,&status);
+	// pakets of lost slaves are simulated (and counted) twice
+	while (SpinsDone < TotalNoSpins) {
+	  if (MPI_Recv(&NowDone,1,MPI_INT,MPI_ANY_SOURCE,SPINS_PROGRESS,MPI_COMM_WORLD,&status) != MPI_SUCCESS)
+		  continue;
 		SpinsDone += NowDone;
 
         //update progress counter
 		int progr = (100*(SpinsDone+1)/TotalNoSpins);
+		if (progr > 100) progr = 100;
 		if ( progr != progress_percent) {
 			progress_percent = progr;
 			ofstream fout(".jemris_progress.out" , ios::out);
@@ -108,6 +376,108 @@ void* CountProgress(void * arg) {
 }
 #endif
 
+/*****************************************************************************/
+/**
+ *  slaves which failed (ULFM extension; without it, failures are found by timeouts only)
+ */
+std::vector<int> mpi_failed_slaves () {
+
+	std::vector<int> failed;
+
+#ifdef MPIX_ERR_PROC_FAILED
+	MPI_Group fgroup, wgroup;
+	int       n;
+
+	MPIX_Comm_failure_ack(MPI_COMM_WORLD);
+	MPIX_Comm_failure_get_acked(MPI_COMM_WORLD, &fgroup);
+	MPI_Comm_group(MPI_COMM_WORLD, &wgroup);
+	MPI_Group_size(fgroup, &n);
+
+	std::vector<int> franks (n), wranks (n);
+	for (int i=0; i < n; i++)
+		franks[i] = i;
+	MPI_Group_translate_ranks(fgroup, n, franks.data(), wgroup, wranks.data());
+	for (int i=0; i < n; i++)
+		if (wranks[i] > 0)
+			failed.push_back(wranks[i]);
+
+	MPI_Group_free(&fgroup);
+	MPI_Group_free(&wgroup);
+#endif
+
+	return failed;
+
+}
+
+/**
+ * Send buffers of the master, one set per slave
+ */
+struct PaketSend {
+	std::vector<MPI_Request>           req;        /**< begin spin, no of spins, spin data   */
+	std::vector<int>                   spins;      /**< no of spins                          */
+	std::vector<long>                  begin;      /**< first spin (or PaketEnd)             */
+	std::vector< std::vector<double> > data;       /**< spin data (unless procedural)        */
+	MPI_Datatype                       spindata;   /**< MPI type of a spin                   */
+	bool                               procedural; /**< slaves generate their spins          */
+	long                               nprops;     /**< no of properties per spin            */
+};
+
+/*****************************************************************************/
+/**
+ *  get the next paket of a slave into its send buffers; returns the no of spins
+ */
+int mpi_next_paket (PaketSend& ps, int SlaveID, Sample* pSam) {
+
+	int NoSpins, NextSpinToSend;
+
+	// previous paket of this slave has to be on its way before its buffers are reused
+	MPI_Waitall(3, &ps.req[3*SlaveID], MPI_STATUSES_IGNORE);
+
+	master_lock();
+	pSam->GetNextPacket(NoSpins,NextSpinToSend,SlaveID);
+	if (!ps.procedural) {
+		size_t n = (size_t) NoSpins * ps.nprops;
+		ps.data[SlaveID].resize(n);
+		if (n > 0)
+			memcpy (&ps.data[SlaveID][0], pSam->GetSpinsData(NextSpinToSend, NoSpins), n * sizeof(double));
+		pSam->ClearSpinsPacket();
+	}
+	master_unlock();
+
+	ps.spins[SlaveID] = NoSpins;
+	ps.begin[SlaveID] = NextSpinToSend;
+
+	return NoSpins;
+
+}
+
+/*****************************************************************************/
+/**
+ *  send the paket in the buffers of a slave
+ */
+void mpi_send_paket (PaketSend& ps, int SlaveID) {
+
+	MPI_Isend(&ps.begin[SlaveID],1,MPI_LONG,SlaveID,SEND_BEGIN_SPIN,MPI_COMM_WORLD,&ps.req[3*SlaveID]);
+	MPI_Isend(&ps.spins[SlaveID],1,MPI_INT,SlaveID,SEND_NO_SPINS, MPI_COMM_WORLD,&ps.req[3*SlaveID+1]);
+	if (!ps.procedural)
+		MPI_Isend(ps.data[SlaveID].data(), ps.spins[SlaveID], ps.spindata,SlaveID,SEND_SAMPLE, MPI_COMM_WORLD,&ps.req[3*SlaveID+2]);
+
+}
+
+/*****************************************************************************/
+/**
+ *  send the final (empty) paket to a slave
+ */
+void mpi_end_paket (PaketSend& ps, int SlaveID, int end) {
+
+	MPI_Waitall(3, &ps.req[3*SlaveID], MPI_STATUSES_IGNORE);
+	ps.spins[SlaveID] = 0;
+	ps.begin[SlaveID] = end;
+	ps.data[SlaveID].clear();
+	mpi_send_paket(ps, SlaveID);
+
+}
+
 /*****************************************************************************/
 void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
 
@@ -164,13 +534,14 @@ void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
         printf("I'm process %i out of %i processes\n", my_id, num_procs);*/
 
         int ii;
-        long TotalSpinNumber=pSam->GetSize(),nextSpinMem=-1;
+        long TotalSpinNumber=pSam->GetSize();
         for(ii=0;ii<size;ii++)
         {
             //cout<<ii<<" Sencount "<<sendcount[ii]<<" Displs "<<displs[ii]<<endl;
             if(ii>0)    {
+                long beginSpin = displs[ii];
                 MPI_Send(&TotalSpinNumber,1,MPI_LONG,ii,SEND_TOTAL_NO_SPINS,MPI_COMM_WORLD);
-                MPI_Send(&displs[ii],1,MPI_LONG,ii,SEND_BEGIN_SPIN,MPI_COMM_WORLD);
+                MPI_Send(&beginSpin,1,MPI_LONG,ii,SEND_BEGIN_SPIN,MPI_COMM_WORLD);
                 //cout<<0<<" Sent spins index information to "<<ii<<" :  "<<TotalSpinNumber<<"  "<<displs[ii]<<endl;
                 }
         }
@@ -192,59 +563,226 @@ void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
 	int csize = pSam->GetNoSpinCompartments();
 	MPI_Bcast    (&csize , 1, MPI_INT, 0, MPI_COMM_WORLD);
 // */
+	int isize = pSam->GetIsochromats();
+	MPI_Bcast    (&isize , 1, MPI_INT, 0, MPI_COMM_WORLD);
+
 	MPI_Datatype MPI_SPINDATA = MPIspindata();
 
-	//scatter sendcounts:
-	MPI_Scatterv (pSam->GetSpinsData(), sendcount.data(), displs.data(),
-			MPI_SPINDATA, &recvdummy, 0, MPI_SPINDATA, 0, MPI_COMM_WORLD);
+	// procedural samples are generated by the slaves themselves
+	bool procedural = pSam->IsProcedural();
+
+	//scatter sendcounts (isochromats are expanded for the first pakets only):
+	if (!procedural) {
+		// a computing master takes its first paket from the sample itself
+		std::vector<int> scattercount (sendcount);
+		scattercount[0] = 0;
+		MPI_Scatterv (pSam->GetSpinsData(0, displs[size-1]+sendcount[size-1]), scattercount.data(), displs.data(),
+				MPI_SPINDATA, &recvdummy, 0, MPI_SPINDATA, 0, MPI_COMM_WORLD);
+		pSam->ClearSpinsPacket();
+	}
 	// broadcast resolution:
 	MPI_Bcast    (pSam->GetResolution(),3,MPI_DOUBLE,0, MPI_COMM_WORLD);
 
-	// now listen for paket requests:
-	int SlavesDone=0;
-	while (SlavesDone < size - 1) {
+#ifdef HAVE_MPI_THREADS
+	// the computing master may start now
+	master_lock();
+	s_master.ready = true;
+	pthread_cond_broadcast(&s_master.cond);
+	master_unlock();
+#endif
 
-		int     SlaveID;
-		int     NoSpins;
-		int     NextSpinToSend;
+	// slaves size their prefetch buffer by the maximal paket size:
+	int maxpaket = pSam->GetMaxPaketSize();
+	MPI_Bcast    (&maxpaket, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	// pakets are sent non-blocking; buffers of each slave are kept until the send completed
+	PaketSend ps;
+	ps.req.assign (3*size, MPI_REQUEST_NULL);
+	ps.spins.resize (size);
+	ps.begin.resize (size);
+	ps.data.resize (size);
+	ps.spindata   = MPI_SPINDATA;
+	ps.procedural = procedural;
+	ps.nprops     = NProps;
+
+	// slaves which are not heard of in time are lost
+	double timeout = WORKER_TIMEOUT;
+#ifndef HAVE_MPI_THREADS
+	if (timeout < 10.0 * pSam->GetTimeInterval()) timeout = 10.0 * pSam->GetTimeInterval();
+#endif
+	std::vector<int>    state (size, SLAVE_WORKING);
+	std::vector<double> seen  (size, MPI_Wtime());
+	state[0] = SLAVE_CLOSED;
+	int active = size - 1;	// slaves neither done nor lost
+	int open   = size - 1;	// slaves not yet accounted for
+	int parked = 0;
+	int lost   = 0;
+	bool ended = false;		// final pakets sent
+
+	// failures of slaves are reported instead of aborting the run
+	MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN);
+
+	int         msg[3];
+	MPI_Request ctrlreq;
+	MPI_Irecv(msg, 3, MPI_INT, MPI_ANY_SOURCE, REQUEST_SPINS, MPI_COMM_WORLD, &ctrlreq);
+
+	// now listen for paket requests, signals and heartbeats, until every slave is accounted for:
+	while (open > 0) {
+
+		// all slaves finished: tell them how their signals are collected
+		if (!ended && parked == active) {
+			s_paket_end = (lost > 0) ? END_GATHER : END_REDUCE;
+			for (int i=1; i < size; i++)
+				if (state[i] == SLAVE_PARKED) {
+					state[i] = SLAVE_DONE;
+					s_gather.push_back(i);
+					mpi_end_paket(ps, i, s_paket_end);
+				}
+			parked = 0;
+			ended  = true;
+		}
+
+		int        flag = 0;
+		int        err;
 		MPI_Status status;
-		MPI_Recv(&SlaveID, 1, MPI_INT, MPI_ANY_SOURCE,
-				REQUEST_SPINS, MPI_COMM_WORLD, &status);
+		std::vector<int> failed;
+
+		err = MPI_Test(&ctrlreq, &flag, &status);
+		if (err != MPI_SUCCESS) {
+			failed = mpi_failed_slaves();
+			if (failed.empty()) {
+				cout << endl << "receiving paket requests failed! exit." << endl;
+				MPI_Abort(MPI_COMM_WORLD, err);
+			}
+#ifdef MPIX_ERR_PROC_FAILED_PENDING
+			int eclass;
+			MPI_Error_class(err, &eclass);
+			if (eclass != MPIX_ERR_PROC_FAILED_PENDING)
+#endif
+				MPI_Irecv(msg, 3, MPI_INT, MPI_ANY_SOURCE, REQUEST_SPINS, MPI_COMM_WORLD, &ctrlreq);
+		}
 
-		//get next spin paket to send:
-		pSam->GetNextPacket(NoSpins,NextSpinToSend,SlaveID);
+		if (!flag) {
+
+			// silent slaves: lost ones are given up after a second timeout
+			double now = MPI_Wtime();
+			std::vector<bool> dead (size, false);
+			for (unsigned int j=0; j < failed.size(); j++)
+				dead[failed[j]] = true;
+			for (int i=1; i < size; i++)
+				if (state[i] != SLAVE_CLOSED && now - seen[i] > ((state[i] == SLAVE_LOST) ? 2.0 : 1.0) * timeout)
+					failed.push_back(i);
+
+			bool requeued = false;
+			for (unsigned int j=0; j < failed.size(); j++) {
+				int i = failed[j];
+				if (state[i] == SLAVE_CLOSED)
+					continue;
+
+				for (int k=0; k < 3; k++)
+					if (ps.req[3*i+k] != MPI_REQUEST_NULL)
+						MPI_Request_free(&ps.req[3*i+k]);
+
+				// the final paket was sent, or the pakets are requeued already: the slave is given up
+				if (state[i] != SLAVE_WORKING && state[i] != SLAVE_PARKED) {
+					cout << endl << "slave " << i << " given up" << endl;
+					s_gather.erase(std::remove(s_gather.begin(), s_gather.end(), i), s_gather.end());
+					state[i] = SLAVE_CLOSED;
+					open--;
+					continue;
+				}
+
+				cout << endl << "slave " << i << ( dead[i] ? " failed" : " timed out" ) << endl;
+				if (state[i] == SLAVE_PARKED) parked--;
+				state[i] = dead[i] ? SLAVE_CLOSED : SLAVE_LOST;
+				if (dead[i]) open--;
+				active--;
+				lost++;
+				master_lock();
+				pSam->WorkerLost(i);
+				master_unlock();
+				requeued = true;
+			}
+
+			// pakets of lost slaves go to the parked slaves
+			if (requeued)
+				for (int i=1; i < size; i++)
+					if (state[i] == SLAVE_PARKED && mpi_next_paket(ps, i, pSam) > 0) {
+						mpi_send_paket(ps, i);
+						state[i] = SLAVE_WORKING;
+						seen[i]  = now;
+						parked--;
+					}
+
+			if (active == 0 && !ended) {
+				cout << endl << "all slaves lost! exit." << endl;
+				MPI_Abort(MPI_COMM_WORLD, -1);
+			}
+
+			if (!requeued)
+				usleep(1000);
+			continue;
 
+		}
 
-        //MODIF
-        for(ii=0;ii<size;ii++)
-        {
-            //cout<<ii<<" sencount "<<NoSpins<<" displs "<<NextSpinToSend<<endl;
-            if(ii>0 && NextSpinToSend!=nextSpinMem)    {
-                MPI_Send(&NextSpinToSend,1,MPI_LONG,SlaveID,SEND_BEGIN_SPIN,MPI_COMM_WORLD);
-                //cout<<endl<<0<<" sent spins index information to "<<SlaveID<<" :  "<<"--- "<<NextSpinToSend<<endl;
-                nextSpinMem=NextSpinToSend;
-                if(nextSpinMem<0)   nextSpinMem-=1;
-                }
+		int ctrl[3] = {msg[0], msg[1], msg[2]};
+		int SlaveID = ctrl[0];
+		seen[SlaveID] = MPI_Wtime();
+		MPI_Irecv(msg, 3, MPI_INT, MPI_ANY_SOURCE, REQUEST_SPINS, MPI_COMM_WORLD, &ctrlreq);
+
+		if (ctrl[1] == PAKET_HEARTBEAT)
+			continue;
+
+		// last message of a slave
+		if (ctrl[1] == PAKET_DONE) {
+			if (state[SlaveID] != SLAVE_CLOSED) {
+				state[SlaveID] = SLAVE_CLOSED;
+				open--;
+			}
+			continue;
+		}
 
-        }
-        //MODIF***
+		if (ctrl[1] == PAKET_SIGNAL) {
 
+			// the pakets of a lost (or given up) slave are simulated by others: discard its signal
+			bool add = (state[SlaveID] == SLAVE_WORKING);
 
-		if (NoSpins == 0)
-			SlavesDone++;
+			// restart checkpoint: add signal of the oldest pakets of this slave
+			master_lock();
+			for (unsigned int i=0; i < RxCA->GetSize(); i++)
+				mpi_recv_paket_signal(RxCA->GetCoil(i)->GetSignal(),SlaveID,i,add);
+			if (add) {
+				for (int i=0; i < ctrl[2]; i++)
+					pSam->PaketDone(SlaveID);
 
-		// receive signal
-		for (unsigned int i=0; i < RxCA->GetSize(); i++)
-			mpi_recv_paket_signal(RxCA->GetCoil(i)->GetSignal(),SlaveID,i);
+				// dump temp signal
+				pSam->DumpRestartInfo(RxCA);
+			}
+			master_unlock();
+			continue;
 
-		// dump temp signal
-		pSam->DumpRestartInfo(RxCA);
+		}
 
-		// now send NoSpins
-		MPI_Send(&NoSpins,1,MPI_INT,SlaveID,SEND_NO_SPINS, MPI_COMM_WORLD);
-		if (NoSpins > 0)
-			MPI_Send(&(pSam->GetSpinsData())[NextSpinToSend*pSam->GetNProps()],
-					NoSpins, MPI_SPINDATA,SlaveID,SEND_SAMPLE, MPI_COMM_WORLD);
+		// slave was considered lost (or even given up), but is alive: dismiss it
+		if (state[SlaveID] == SLAVE_LOST || state[SlaveID] == SLAVE_CLOSED) {
+			cout << endl << "slave " << SlaveID << " is alive again; dismissed" << endl;
+			if (state[SlaveID] == SLAVE_CLOSED) open++;
+			state[SlaveID] = SLAVE_DISMISSED;
+			s_gather.push_back(SlaveID);
+			mpi_end_paket(ps, SlaveID, END_DISMISSED);
+			continue;
+		}
+
+		if (state[SlaveID] != SLAVE_WORKING)
+			continue;
+
+		//get next spin paket to send; park the slave if none is left
+		int NoSpins = mpi_next_paket(ps, SlaveID, pSam);
+		if (NoSpins == 0) {
+			state[SlaveID] = SLAVE_PARKED;
+			parked++;
+		} else
+			mpi_send_paket(ps, SlaveID);
 
 #ifndef HAVE_MPI_THREADS
 
@@ -257,8 +795,9 @@ void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
 		//update progress counter (pjemris without threads support)
 		World* pW = World::instance();
 		int progr = (100*(spinsdone+1)/pW->TotalSpinNumber);
+		if (progr > 100) progr = 100;
 		// case of restart: set progress to 100 at end:
-		if (SlavesDone==(size-1)) progr=100;
+		if (parked == active) progr=100;
 
 		if (progr != progress_percent) {
 			progress_percent = progr;
@@ -268,7 +807,12 @@ void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
 		}
 #endif
 
-	}  // end while (SlavesDone < size -1)
+	}  // end while (open > 0)
+
+	MPI_Cancel(&ctrlreq);
+	MPI_Wait(&ctrlreq, MPI_STATUS_IGNORE);
+	MPI_Waitall(3*size, ps.req.data(), MPI_STATUSES_IGNORE);
+	MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_ARE_FATAL);
 
 	flush (cout);
 
@@ -286,13 +830,154 @@ void mpi_devide_and_send_sample (Sample* pSam, CoilArray* RxCA ) {
 
 }
 
+#ifdef HAVE_MPI_THREADS
+/*****************************************************************************/
+/**
+ *  arguments of the paket distribution thread of a computing master
+ */
+struct MasterArgs {
+	Sample*    pSam;  /**< the whole sample  */
+	CoilArray* RxCA;  /**< the master signal */
+};
+
+/*****************************************************************************/
+/* paket distribution of a computing master; started as an extra thread */
+void* mpi_distribute_sample (void* arg) {
+
+	MasterArgs* a = (MasterArgs*) arg;
+	mpi_devide_and_send_sample(a->pSam, a->RxCA);
+
+	return NULL;
+
+}
+
+/*****************************************************************************/
+/**
+ *  create the (empty) sample which the master simulates its own pakets with;
+ *  waits until the distribution thread scattered the initial pakets
+ */
+Sample* mpi_master_sample (Sample* pSam) {
+
+	master_lock();
+	while (!s_master.ready)
+		pthread_cond_wait(&s_master.cond, &s_master.lock);
+
+	Sample* samp = new Sample();
+	samp->CreateSpins(pSam->GetNProps(), 0);
+	samp->CreateHelper(pSam->GetHelperSize());
+	pSam->CopyHelper(samp->GetHelper());
+	samp->SetSampleDims(pSam->GetSampleDims());
+	samp->SetNoSpinCompartments(pSam->GetNoSpinCompartments());
+	samp->SetIsochromatSeeding(pSam->GetIsochromats() > 1);
+	memcpy (samp->GetResolution(), pSam->GetResolution(), 3 * sizeof(double));
+	master_unlock();
+
+	return samp;
+
+}
+
+/*****************************************************************************/
+/**
+ *  take the next paket of the computing master (slave 0) directly from the whole sample
+ * 	if no spins are left -> return false else true
+ *  the signal accumulated by the master is added to the master signal at restart checkpoints
+ */
+bool mpi_master_sample_paket (Sample* samp, CoilArray* RxCA, Sample* pSam, CoilArray* MasterRxCA) {
+
+	static bool   first    = true;
+	static int    pakets   = 0;
+	static double lastdump = MPI_Wtime();
+
+	World* pW = World::instance();
+	vector<size_t> d = samp->GetSampleDims();
+	int NoSpins, NextSpinToSend;
+
+	master_lock();
+
+	// restart checkpoint
+	if (pakets > 0 && MPI_Wtime() - lastdump > pW->m_checkpointInterval) {
+		for (unsigned int i=0; i < RxCA->GetSize(); i++) {
+			Repository* repo = RxCA->GetCoil(i)->GetSignal()->Repo();
+			Repository* dest = MasterRxCA->GetCoil(i)->GetSignal()->Repo();
+			for (long j=0; j < repo->Size(); j++)
+				dest->Add (j, repo->Value(j));
+			memcpy (dest->Times(), repo->Times(), repo->Samples() * sizeof(double));
+			repo->Clear();
+		}
+		for (int i=0; i < pakets; i++)
+			pSam->PaketDone(0);
+		pSam->DumpRestartInfo(MasterRxCA);
+		pakets   = 0;
+		lastdump = MPI_Wtime();
+	}
+
+	if (first)
+		pSam->GetScatterPacket(NoSpins, NextSpinToSend, 0);
+	else
+		pSam->GetNextPacket(NoSpins, NextSpinToSend, 0);
+
+	// the initial paket may be empty (restart, load balancing)
+	if (NoSpins == 0 && first) {
+		first = false;
+		pakets++;
+		pSam->GetNextPacket(NoSpins, NextSpinToSend, 0);
+	}
+	first = false;
+
+	if (NoSpins == 0) {
+		master_unlock();
+		return false;
+	}
+
+	samp->ClearSpins();
+	samp->CreateSpins(NoSpins);
+	samp->SetSampleDims(d);
+	memcpy (samp->GetSpinsData(), pSam->GetSpinsData(NextSpinToSend, NoSpins), (size_t) NoSpins * samp->GetNProps() * sizeof(double));
+	pSam->ClearSpinsPacket();
+	pakets++;
+
+	master_unlock();
+
+	pW->setTrajLoading(NextSpinToSend, pW->getTrajNumber(), NoSpins);
+
+	return true;
+
+}
+#endif
+
+/*****************************************************************************/
+/**
+ *  request the next paket of spins without waiting for it;
+ *  the paket is collected by the next call of mpi_recieve_sample_paket
+ */
+void mpi_prefetch_sample_paket(Sample *samp, Sample* source = NULL){
+
+	PaketPrefetch& pf = s_prefetch;
+	pf.ctrl[0] = World::instance()->m_myRank;
+	pf.ctrl[1] = PAKET_REQUEST;
+	pf.ctrl[2] = 0;
+
+	MPI_Isend(pf.ctrl,3,MPI_INT,0,REQUEST_SPINS,MPI_COMM_WORLD,&pf.req[0]);
+	MPI_Irecv(&pf.nospins,1,MPI_INT,0,SEND_NO_SPINS,MPI_COMM_WORLD,&pf.req[1]);
+	MPI_Irecv(&pf.begin,1,MPI_LONG,0,SEND_BEGIN_SPIN,MPI_COMM_WORLD,&pf.req[2]);
+
+	if (source != NULL)
+		pf.req[3] = MPI_REQUEST_NULL;
+	else {
+		pf.data.resize((size_t) pf.maxpaket * samp->GetNProps());
+		MPI_Irecv(pf.data.data(),pf.maxpaket,MPIspindata(),0,SEND_SAMPLE,MPI_COMM_WORLD,&pf.req[3]);
+	}
+
+}
+
 /*
  * Receive first portion of sample from MPI master process.
+ * @param  source procedural sample from which the slave generates its spins itself (NULL: receive spins)
  * @return pointer to the new (sub)sample.
  *         Deletion of the (sub)sample has to be done elsewehere!
  *         (This is e.g. done by the Simulator class)
  */
-Sample* mpi_receive_sample(int sender, int tag){
+Sample* mpi_receive_sample(int sender, int tag, Sample* source = NULL){
 
 	long NPoints;
 	World* pW = World::instance();
@@ -307,7 +992,7 @@ Sample* mpi_receive_sample(int sender, int tag){
 	MPI_Status status;
 	MPI_Recv(&TotalSpinNumber,1,MPI_LONG,0,SEND_TOTAL_NO_SPINS,MPI_COMM_WORLD,&status);
 	MPI_Recv(&beginTraj,1,MPI_LONG,0,SEND_BEGIN_SPIN,MPI_COMM_WORLD,&status);
-	pW->setTrajLoading(beginTraj,TotalSpinNumber);
+	pW->setTrajLoading(beginTraj,TotalSpinNumber,nospins);
 	int num_traj=beginTraj;
 	//cout<<World::instance()->m_myRank<<" Received spins index information:  "<<TotalSpinNumber<<"  "<<num_traj<<endl;
 	//MODIF***
@@ -340,13 +1025,33 @@ Sample* mpi_receive_sample(int sender, int tag){
 	pSam->SetNoSpinCompartments(csize);
 	/* << required for multi-pool samples with exchange*/
 
+	// isochromats arrive expanded; their randomness is seeded with the spin ID
+	int isize = 1;
+	MPI_Bcast (&isize, 1, MPI_INT,0, MPI_COMM_WORLD);
+	pSam->SetIsochromatSeeding(isize > 1);
+
 
 	MPI_Datatype MPI_SPINDATA = MPIspindata();
 	// get sample:
-	MPI_Scatterv (NULL,NULL,NULL,MPI_SPINDATA,pSam->GetSpinsData(),nospins,MPI_SPINDATA,0, MPI_COMM_WORLD);
+	if (source != NULL) {
+		source->SetIsochromats(isize);
+		if (nospins > 0)
+			memcpy (pSam->GetSpinsData(), source->GetSpinsData(beginTraj, nospins), nospins * NProps * sizeof(double));
+		source->ClearSpinsPacket();
+	} else
+		MPI_Scatterv (NULL,NULL,NULL,MPI_SPINDATA,pSam->GetSpinsData(),nospins,MPI_SPINDATA,0, MPI_COMM_WORLD);
 	//get resolution (needed for position randomness)
 	MPI_Bcast    (pSam->GetResolution(),3,MPI_DOUBLE,0, MPI_COMM_WORLD);
 
+	// request the second paket while the first one is simulated
+	MPI_Bcast    (&s_prefetch.maxpaket,1,MPI_INT,0, MPI_COMM_WORLD);
+	s_prefetch.pakets   = 0;
+	s_prefetch.lastdump = MPI_Wtime();
+	mpi_prefetch_sample_paket(pSam, source);
+
+	// the master hears of this slave while it simulates long pakets
+	mpi_start_heartbeat();
+
 	int ilen; std::string  hm (MPI_MAX_PROCESSOR_NAME, ' ');
 	MPI_Get_processor_name(&hm[0],&ilen);
 	//MODIF
@@ -362,92 +1067,156 @@ Sample* mpi_receive_sample(int sender, int tag){
 /**
  *  receive next small package of spins (first paket by mpi_receive_sample)
  * 	if no spins are left -> return false else true
+ *  the paket was requested by mpi_prefetch_sample_paket while the previous one was simulated;
+ *  the paket after it is requested before returning
+ *  with a procedural source, only the paket range is received and the spins are generated locally
  */
-bool mpi_recieve_sample_paket(Sample *samp, CoilArray* RxCA ){
+bool mpi_recieve_sample_paket(Sample *samp, CoilArray* RxCA, Sample* source = NULL ){
 
 	World* pW 	= World::instance();
-	int myRank 	= pW->m_myRank;
-	int NoSpins = 0;
+	PaketPrefetch& pf = s_prefetch;
 
 	//backup dimensions
 	vector<size_t> d = samp->GetSampleDims();
 
-	// request new spins:
-	MPI_Send(&myRank,1,MPI_INT,0,REQUEST_SPINS,MPI_COMM_WORLD);
+	pf.pakets++;
 
-	// send signal
-	for (unsigned int i=0; i < RxCA->GetSize(); i++)
-		mpi_send_paket_signal(RxCA->GetCoil(i)->GetSignal(),i);
-	
-	// Receive number of spins
-	MPI_Status status;
-	MPI_Recv(&NoSpins,1,MPI_INT,0,SEND_NO_SPINS,MPI_COMM_WORLD,&status);
-	
-    	//MODIF
-	long TotalSpinNumber=World::instance()->getTrajNumber(),beginTraj=0;
-	//cout<<World::instance()->m_myRank<<" query spins index information:  "<<endl;
-	//MPI_Recv(&TotalSpinNumber,1,MPI_LONG,0,SEND_TOTAL_NO_SPINS,MPI_COMM_WORLD,&status);
-	MPI_Recv(&beginTraj,1,MPI_LONG,0,SEND_BEGIN_SPIN,MPI_COMM_WORLD,&status);
-	World::instance()->setTrajLoading(beginTraj,TotalSpinNumber);
-	//cout<<endl<<World::instance()->m_myRank<<" received spins index information:  "<<TotalSpinNumber<<"  "<<beginTraj<<endl;
-	//MODIF***
+	// collect prefetched paket
+	MPI_Waitall(4, pf.req, MPI_STATUSES_IGNORE);
+	int  NoSpins   = pf.nospins;
+	long beginTraj = pf.begin;
+	pW->setTrajLoading(beginTraj,pW->getTrajNumber(),NoSpins);
+
+	// Spins left? (remaining signal is collected by mpi_reduce_signals)
+	if (NoSpins == 0) {
+		s_paket_end = (int) beginTraj;
+		mpi_stop_heartbeat();
+		return false;
+	}
+
+	// restart checkpoint: hand the signal accumulated so far to the master and start over
+	if (MPI_Wtime() - pf.lastdump > pW->m_checkpointInterval) {
+		int ctrl[3] = {pW->m_myRank, PAKET_SIGNAL, pf.pakets};
+		MPI_Send(ctrl,3,MPI_INT,0,REQUEST_SPINS,MPI_COMM_WORLD);
+		for (unsigned int i=0; i < RxCA->GetSize(); i++) {
+			Signal* pSig = RxCA->GetCoil(i)->GetSignal();
+			mpi_send_paket_signal(pSig,i);
+			pSig->Repo()->Clear();
+		}
+		pf.pakets   = 0;
+		pf.lastdump = MPI_Wtime();
+	}
 
-	// Spins left?
-	if (NoSpins == 0) return false;
-	
 	// prepare sample structure
 	samp->ClearSpins();
 	samp->CreateSpins(NoSpins);
 	samp->SetSampleDims(d);
 
+	size_t n = (size_t) NoSpins * samp->GetNProps();
+	if (source != NULL) {
+		memcpy (samp->GetSpinsData(), source->GetSpinsData(beginTraj, NoSpins), n * sizeof(double));
+		source->ClearSpinsPacket();
+	} else
+		memcpy (samp->GetSpinsData(), pf.data.data(), n * sizeof(double));
+
+	// request the next paket while this one is simulated
+	mpi_prefetch_sample_paket(samp, source);
 
-	
-	// Receive
-	MPI_Datatype MPI_SPINDATA = MPIspindata();
-	MPI_Recv(samp->GetSpinsData(),NoSpins,MPI_SPINDATA,0,SEND_SAMPLE,MPI_COMM_WORLD,&status);
-	int ilen; std::string hm (MPI_MAX_PROCESSOR_NAME, ' ');
-	MPI_Get_processor_name(&hm[0],&ilen);
-	//MODIF
-	//cout <<endl<< "hostname" << " -> slave " << setw(2) << MPI::COMM_WORLD.Get_rank() << ":  received "
-	//     << NoSpins << " spins for simulation ..." << endl << flush;
-    //pW->setTrajLoading(myRank,NoSpins);
-    //MODIF***
-/*
-	cout << endl << "SLAVE: " << setw(2) << MPI::COMM_WORLD.Get_rank()
-		 << " , #Pools= " << samp->GetNoSpinCompartments() << " , SampleDims=" << samp->GetSampleDimsSize() << " , SampleProps= " << samp->GetNProps() << " , NextPackageSize=" << samp->GetSize()
-		 << " , ExMatDim=" << samp->GetHelperSize() <<  endl << endl;
-// */
 	return true;
 
 }
 /*****************************************************************************/
 void mpi_send_paket_signal (Signal* pSig, const int CoilID) {
 	
-	int     tsize = (int) pSig->Repo()->Size();
+	Repository*  repo  = pSig->Repo();
+	int          tsize = (int) repo->Size();
+	MPI_Datatype type  = repo->Compact() ? MPI_FLOAT : MPI_DOUBLE;
 	
-	if (World::instance()->m_myRank == 1)
-		MPI_Send(pSig->Repo()->Times(), (int) pSig->Repo()->Samples(), MPI_DOUBLE, 0, SIG_TP + (CoilID)*4,MPI_COMM_WORLD);
+	MPI_Send(repo->Times(), (int) repo->Samples(), MPI_DOUBLE, 0, SIG_TP + (CoilID)*4,MPI_COMM_WORLD);
 
-	MPI_Send(pSig->Repo()->Data(), tsize, MPI_DOUBLE, 0, SIG_MX + (CoilID)*4,MPI_COMM_WORLD);
+	// compact signals are sent in single precision, the compensation folded in
+	repo->Fold();
+	MPI_Send(repo->Buffer(), tsize, type, 0, SIG_MX + (CoilID)*4,MPI_COMM_WORLD);
 
 	
 }
 
 /*****************************************************************************/
-void mpi_recv_paket_signal(Signal *pSig, const int SlaveId, const int CoilID) {
-
-	int     tsize = (int) pSig->Repo()->Size();
-	double* data  = pSig->Repo()->Data(); 
-	std::vector<double> tmp (tsize);
+void mpi_recv_paket_signal(Signal *pSig, const int SlaveId, const int CoilID, bool add) {
+
+	Repository* repo  = pSig->Repo();
+	int     tsize = (int) repo->Size();
+	int     nsamp = (int) repo->Samples();
+	std::vector<double> tmp;
+	std::vector<float>  ftmp;
+	std::vector<double> tp  (nsamp);
 	MPI_Status status;
 	
-	if (SlaveId == 1)
-	  MPI_Recv(pSig->Repo()->Times(), (int) pSig->Repo()->Samples(), MPI_DOUBLE, SlaveId, SIG_TP + (CoilID)*4,MPI_COMM_WORLD,&status);
+	MPI_Recv(&tp[0], nsamp, MPI_DOUBLE, SlaveId, SIG_TP + (CoilID)*4,MPI_COMM_WORLD,&status);
 	
-	MPI_Recv(&tmp[0], tsize, MPI_DOUBLE, SlaveId, SIG_MX + (CoilID)*4,MPI_COMM_WORLD,&status);
+	if (repo->Compact()) {
+		ftmp.resize(tsize);
+		MPI_Recv(&ftmp[0], tsize, MPI_FLOAT, SlaveId, SIG_MX + (CoilID)*4,MPI_COMM_WORLD,&status);
+	} else {
+		tmp.resize(tsize);
+		MPI_Recv(&tmp[0], tsize, MPI_DOUBLE, SlaveId, SIG_MX + (CoilID)*4,MPI_COMM_WORLD,&status);
+	}
+
+	// signal of a lost slave: receive, but discard
+	if (!add)
+		return;
+
+	// slaves without spins hold zero time points
+	double* times = repo->Times();
+	for (int i = 0; i < nsamp; i++)
+		if (tp[i] > times[i])
+			times[i] = tp[i];
 
 	for (int i = 0; i < tsize; i++) 
-		data[i] += tmp[i];
+		repo->Add (i, repo->Compact() ? (double) ftmp[i] : tmp[i]);
+
+}
+
+/*****************************************************************************/
+/**
+ *  sum up the signals of all processes at the master (collective call)
+ *  time points are equal on all slaves which simulated spins, others hold zeros
+ */
+void mpi_reduce_signals(CoilArray* RxCA) {
+
+	bool master = (World::instance()->m_myRank == 0);
+
+	// slaves were lost: the collective would not complete, so collect point-to-point
+	if (s_paket_end != END_REDUCE) {
+		for (unsigned int i=0; i < RxCA->GetSize(); i++) {
+			Signal* pSig = RxCA->GetCoil(i)->GetSignal();
+			if (master)
+				for (unsigned int j=0; j < s_gather.size(); j++)
+					mpi_recv_paket_signal(pSig, s_gather[j], i, true);
+			else {
+				if (s_paket_end == END_DISMISSED)
+					pSig->Repo()->Clear();
+				mpi_send_paket_signal(pSig, i);
+			}
+		}
+		return;
+	}
+
+	for (unsigned int i=0; i < RxCA->GetSize(); i++) {
+
+		Repository*  repo = RxCA->GetCoil(i)->GetSignal()->Repo();
+		MPI_Datatype type = repo->Compact() ? MPI_FLOAT : MPI_DOUBLE;
+
+		repo->Fold();
+		if (master) {
+			MPI_Reduce(MPI_IN_PLACE, repo->Buffer(), (int) repo->Size(),    type,       MPI_SUM, 0, MPI_COMM_WORLD);
+			MPI_Reduce(MPI_IN_PLACE, repo->Times(),  (int) repo->Samples(), MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		} else {
+			MPI_Reduce(repo->Buffer(), NULL, (int) repo->Size(),    type,       MPI_SUM, 0, MPI_COMM_WORLD);
+			MPI_Reduce(repo->Times(),  NULL, (int) repo->Samples(), MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		}
+
+	}
 
 }
 
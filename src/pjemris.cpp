@@ -34,6 +34,7 @@ using namespace std;
 #include "mpi_Model.h"
 #include "config.h"
 #include "Mpi2Evolution.h"
+#include "AnalyticSample.h"
 
 #include <unistd.h>
 #include <sys/stat.h>
@@ -60,6 +61,7 @@ void usage () {
 	cout   << "     -o <output_dir>: Output directory" << endl;
 	cout   << "     -f <filename>:   Output filename (without extension)"  << endl;
 	cout   << "     -r: Start reconstruction after simulation (running recon server is required). "  << endl;
+	cout   << "     -c: Master process simulates spins too (requires MPI with thread support). "  << endl;
 }
 
 int main (int argc, char *argv[]) {
@@ -81,34 +83,23 @@ int main (int argc, char *argv[]) {
 	World* pW = World::instance();
 	pW->m_myRank = my_rank;
 	MPI_Comm_size(MPI_COMM_WORLD, &pW->m_no_processes);
+	mpi_init_node_sharing();
 	int master=0, tag=42;
 	double t1 = MPI_Wtime();
 
 	int size;
 	MPI_Comm_size(MPI_COMM_WORLD, &size);
-	
-	if (size == 1) {
-	  cout << "  !!! MPI failed to launch any slave processes !!!\n" << endl;
-	  cout << "  to take advantage of the parallelization, use the following calls..." << endl;
-	  // https://stackoverflow.com/questions/62503731/invalid-mit-magic-cookie-1-key-when-locally-running-mpi-application-or-starting
-	  // tell hwloc to ignore graphics devices:
-	  cout << "    export HWLOC_COMPONENTS=\"-gl\" " << endl;
-	  // tell the MPI system how many processors to use
-	  cout << "    mpiexec -np <N> pjemris <xml-file>" << endl;
-	  cout << "  where N is the number of processors to use" << endl;
-	    return(-1);
-	}
 
-	
   string output_dir("");
   string filename("");
 
   opterr = 0;
   int status;
   bool recon = false;
+  bool master_computes = false;
 
   int c;
-  while((c = getopt (argc, argv, "f:o:r")) != -1)
+  while((c = getopt (argc, argv, "f:o:rc")) != -1)
   {
     switch (c)
     {
@@ -129,6 +120,9 @@ int main (int argc, char *argv[]) {
       case 'r':
 	recon=true;
 	break;
+      case 'c':
+	master_computes=true;
+	break;
       case '?':
         if (optopt == 'o')
           cerr << "Option '-o' requires an argument." << endl;
@@ -144,6 +138,30 @@ int main (int argc, char *argv[]) {
     }
   }
 
+#ifdef HAVE_MPI_THREADS
+	if (master_computes && provided < MPI_THREAD_MULTIPLE) {
+		if (my_rank == master)
+			cout << "  !!! MPI does not support threads; master process will not simulate spins (option -c) !!!\n" << endl;
+		master_computes = false;
+	}
+#else
+	if (master_computes && my_rank == master)
+		cout << "  !!! pjemris was built without MPI thread support; master process will not simulate spins (option -c) !!!\n" << endl;
+	master_computes = false;
+#endif
+
+	if (size == 1 && !master_computes) {
+	  cout << "  !!! MPI failed to launch any slave processes !!!\n" << endl;
+	  cout << "  to take advantage of the parallelization, use the following calls..." << endl;
+	  // https://stackoverflow.com/questions/62503731/invalid-mit-magic-cookie-1-key-when-locally-running-mpi-application-or-starting
+	  // tell hwloc to ignore graphics devices:
+	  cout << "    export HWLOC_COMPONENTS=\"-gl\" " << endl;
+	  // tell the MPI system how many processors to use
+	  cout << "    mpiexec -np <N> pjemris <xml-file>" << endl;
+	  cout << "  where N is the number of processors to use" << endl;
+	    return(-1);
+	}
+
 	// read simulator settings. Slaves do not read the sample !!!
 	string input="simu.xml";
 	if (argc>1) {
@@ -154,10 +172,14 @@ int main (int argc, char *argv[]) {
 		}
 	}
 	Simulator* psim;
+	Simulator* plocal = NULL; // simulates the own pakets of a computing master
 	if ( my_rank == master)	psim = new Simulator(input);
 	else			psim = new Simulator(input,"NoSample");
 	
-	if ( !psim->GetStatus() ) {
+	// the master also reads the sample: all processes stop if it fails
+	int valid = psim->GetStatus();
+	MPI_Bcast(&valid, 1, MPI_INT, master, MPI_COMM_WORLD);
+	if ( !valid ) {
 		delete psim;
 		MPI_Barrier(MPI_COMM_WORLD);
 		cout << "Input '" << input << "' is not a valid Simulation xml-file." << endl;
@@ -165,6 +187,12 @@ int main (int argc, char *argv[]) {
 		return 0;
 	}
 
+	// virtual receive coils: the master computed the compression from the sample
+	mpi_bcast_compression(psim->GetRxCoilArray());
+
+	// a random seed (drawn from the clock) is the one of the master
+	MPI_Bcast(&pW->m_seed, 1, MPI_UNSIGNED_LONG, master, MPI_COMM_WORLD);
+
 	//MASTER: writes seq-file, Dump seq-report, and sends the sample
 	if ( my_rank == master) {
 		cout << "\nParallel jemris " << VERSION << " "
@@ -196,21 +224,77 @@ int main (int argc, char *argv[]) {
 		RxCA->InitializeSignals( psim->GetSequence()->GetNumOfADCs() );
 		psim->CheckRestart();
 		Mpi2Evolution::OpenFiles((int) psim->GetSample()->IsRestart());
-		// returns when last spin is simulated; collects signals:
-		mpi_devide_and_send_sample( psim->GetSample(), psim->GetRxCoilArray() );
+		if (!master_computes) {
+			// returns when last spin is simulated; collects signals:
+			mpi_devide_and_send_sample( psim->GetSample(), psim->GetRxCoilArray() );
+		}
+#ifdef HAVE_MPI_THREADS
+		else {
+			// distribute pakets on an extra thread and simulate own pakets as slave 0
+			Sample* pSam = psim->GetSample();
+			pSam->SetMasterComputes(true);
+			long TotalSpinNumber = pW->TotalSpinNumber;
+			long StartSpin       = pW->m_startSpin;
+			// the world belongs to psim
+			plocal = new Simulator(input,"NoSample");
+			plocal->ShareWorld();
+			plocal->GetRxCoilArray()->SetCompression(RxCA->GetCompression());
+
+			MasterArgs args = {pSam, RxCA};
+			pthread_t  distributor;
+			if (pthread_create(&distributor, NULL, mpi_distribute_sample, (void *) &args)) {
+				cout << "thread creation failed !! exit."<< endl;
+				exit (-1);
+			}
+
+			// simulate with a rank of its own, which no slave has
+			Sample* samp = mpi_master_sample(pSam);
+			pW->m_myRank    = size;
+			pW->m_startSpin = 0;
+			pW->setTrajLoading(0, TotalSpinNumber);
+			bool SpinsLeft = mpi_master_sample_paket(samp, plocal->GetRxCoilArray(), pSam, RxCA);
+			plocal->SetSample(samp);
+			samp->InitRandGenerator(size);
+			// own spins go to the evolution files opened collectively above
+			pW->saveEvolFunPtr = &Mpi2Evolution::saveEvolution;
+			bool first = true;
+			while (SpinsLeft) {
+				plocal->Simulate(false, first);
+				first = false;
+				SpinsLeft = mpi_master_sample_paket(samp, plocal->GetRxCoilArray(), pSam, RxCA);
+			}
+
+			pthread_join(distributor, NULL);
+			pW->m_myRank        = master;
+			pW->TotalSpinNumber = TotalSpinNumber;
+			pW->m_startSpin     = StartSpin;
+
+			// add own signal
+			if (!first)
+				for (unsigned int i=0; i < RxCA->GetSize(); i++) {
+					Repository* repo = plocal->GetRxCoilArray()->GetCoil(i)->GetSignal()->Repo();
+					Repository* dest = RxCA->GetCoil(i)->GetSignal()->Repo();
+					for (long j=0; j < repo->Size(); j++)
+						dest->Add (j, repo->Value(j));
+					memcpy (dest->Times(), repo->Times(), repo->Samples() * sizeof(double));
+				}
+		}
+#endif
+		// collect the signals accumulated by the slaves
+		mpi_reduce_signals(RxCA);
 		// set output directory
 		RxCA->SetSignalOutputDir(output_dir);
 		if (filename != "")
 			// set output name
 			RxCA->SetSignalPrefix(filename);
 		// dump signals
+		RxCA->ExpandSignals();
 		RxCA->DumpSignals();
-		// Initialize temporary ISMRMRD file with sequence information, afterwards dump signals
-		bool img_adcs = psim->GetSequence()->SeqISMRMRD(RxCA->GetSignalOutputDir() + RxCA->GetSignalPrefix() + "_ismrmrd_tmp.h5");
-		if (img_adcs)
-			RxCA->DumpSignalsISMRMRD("_ismrmrd", true);
-		else
-			remove((RxCA->GetSignalOutputDir() + RxCA->GetSignalPrefix() + "_ismrmrd_tmp.h5").c_str());
+		// ISMRMRD header and acquisitions of the sequence, filled with the signals
+		std::string header;
+		std::vector<ISMRMRD::Acquisition> acqs;
+		if (psim->GetSequence()->SeqISMRMRD(header, acqs))
+			RxCA->DumpSignalsISMRMRD(header, acqs, "_ismrmrd", true);
 		psim->DeleteTmpFiles();
 	}
 
@@ -220,28 +304,45 @@ int main (int argc, char *argv[]) {
 		psim->SetSample(dummy);
 		Mpi2Evolution::OpenFiles ((int) psim->GetSample()->IsRestart());
 		pW->saveEvolFunPtr = &Mpi2Evolution::saveEvolution;
-		psim->SetSample( mpi_receive_sample(master, tag) );
+		// procedural samples: generate own spin pakets instead of receiving them
+		Sample* source = NULL;
+		if (psim->GetAttr(psim->GetElem("sample"), "type") == "analytic")
+			source = new AnalyticSample(psim->GetAttr(psim->GetElem("sample"), "uri"));
+		psim->SetSample( mpi_receive_sample(master, tag, source) );
 		psim->GetSample()->InitRandGenerator( my_rank );
 		psim->Simulate(false); //false = do not Dump signal to binary file !
 		bool SpinsLeft = true;
 
 		while (true) {
 
-			SpinsLeft = mpi_recieve_sample_paket(psim->GetSample(),	psim->GetRxCoilArray());
+			SpinsLeft = mpi_recieve_sample_paket(psim->GetSample(),	psim->GetRxCoilArray(), source);
 
 			if (!SpinsLeft)
 				break;
 
-			psim->Simulate(false); // false = do not Dump signal to binary file !
+			psim->Simulate(false, false); // do not Dump signal to binary file, accumulate signal of all pakets !
 
 		}
+
+		// combine the signals of all slaves at the master
+		mpi_reduce_signals(psim->GetRxCoilArray());
+
+		if (source != NULL)
+			delete source;
 	}
 
-	Mpi2Evolution::CloseFiles();
+	// after slaves were lost, collectives on MPI_COMM_WORLD would not complete: skip them
+	bool lost = mpi_slaves_lost();
+	Mpi2Evolution::CloseFiles(!lost);
+	if (plocal != NULL)
+		delete plocal;
 	delete psim;
+	if (!lost)
+		mpi_free_node_sharing();
 
 	//finished
-	MPI_Barrier(MPI_COMM_WORLD);
+	if (!lost)
+		MPI_Barrier(MPI_COMM_WORLD);
 	double t2 = MPI_Wtime();
 	if ( my_rank == master){
 		printf ("\n\nActual simulation took %.2f seconds.\n", t2-t1);
@@ -72,6 +72,108 @@ double RNG::efix(ulong j, ulong i)
   
 } // RNG::efix
 
+// __________________________________________________________________________
+// Philox4x32-10 of Salmon, Moraes, Dror and Shaw, "Parallel Random
+// Numbers: As Easy as 1, 2, 3", SC'11: ten rounds of a bijection of the
+// 128 bit counter, keyed by a 64 bit key.
+
+static inline void mulhilo32(ulong a, ulong b, ulong& hi, ulong& lo)
+{
+  const unsigned long long p = (unsigned long long) a * b;
+  hi = ULONG32((ulong) (p >> 32));
+  lo = ULONG32((ulong) p);
+}
+
+void RNG::philox(const ulong ctr[4], const ulong key[2], ulong out[4])
+{
+  ulong c0 = ULONG32(ctr[0]), c1 = ULONG32(ctr[1]), c2 = ULONG32(ctr[2]), c3 = ULONG32(ctr[3]);
+  ulong k0 = ULONG32(key[0]), k1 = ULONG32(key[1]);
+  ulong hi0, lo0, hi1, lo1;
+
+  for (int r = 0; r < 10; r++) {
+    if (r > 0) {
+      k0 = ULONG32(k0 + 0x9E3779B9ul);
+      k1 = ULONG32(k1 + 0xBB67AE85ul);
+    }
+    mulhilo32(0xD2511F53ul, c0, hi0, lo0);
+    mulhilo32(0xCD9E8D57ul, c2, hi1, lo1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+  }
+
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+
+} // RNG::philox
+
+// __________________________________________________________________________
+// Counter (n, id, stream) under the key seed; ids and n up to 2^48.
+
+void RNG::counter(ulong seed, ulong id, ulong stream, ulong n, ulong out[4])
+{
+  const unsigned long long s = seed, i = id, m = n;
+  const ulong ctr[4] = { ULONG32((ulong) m), ULONG32((ulong) (((m >> 32) & 0xffffull) | ((i >> 16) & 0xffff0000ull))),
+                         ULONG32((ulong) i), ULONG32(stream) };
+  const ulong key[2] = { ULONG32((ulong) s), ULONG32((ulong) (s >> 32)) };
+
+  philox(ctr, key, out);
+
+} // RNG::counter
+
+// __________________________________________________________________________
+// The KISS seeds must not be zero (MWC, SHR3).
+
+void RNG::init(ulong seed, ulong id, ulong stream)
+{
+  ulong x[4];
+  counter(seed, id, stream, 0, x);
+  init(x[0] | 1ul, x[1] | 1ul, x[2] | 1ul, x[3]);
+
+} // RNG::init
+
+// __________________________________________________________________________
+
+void RNG::normal2(ulong seed, ulong id, ulong stream, ulong n, double& x, double& y)
+{
+  ulong r[4];
+  counter(seed, id, stream, n, r);
+
+  // two 64 bit words to uniforms in (0,1] and [0,1)
+  const double u = ((double) (r[0] * 4294967296.0 + r[1]) + 1.0) / 18446744073709551616.0;
+  const double v =  (double) (r[2] * 4294967296.0 + r[3])        / 18446744073709551616.0;
+  const double a = sqrt(-2.0 * log(u));
+
+  x = a * cos(2.0 * RNGPI * v);
+  y = a * sin(2.0 * RNGPI * v);
+
+} // RNG::normal2
+
+// __________________________________________________________________________
+// No generator state: the iterations are independent and the loop can be vectorized.
+
+void RNG::normal3(ulong seed, ulong stream, int count, const ulong* id, const ulong* n,
+                  double* x, double* y, double* z)
+{
+  const double scale = 1.0 / 4294967296.0;
+
+  for (int i = 0; i < count; i++) {
+    ulong r[4];
+    counter(seed, id[i], stream, n[i], r);
+
+    // uniforms in (0,1] for the radii, [0,1) for the angles
+    const double a = sqrt(-2.0 * log((r[0] + 1.0) * scale));
+    const double b = sqrt(-2.0 * log((r[2] + 1.0) * scale));
+    const double v = 2.0 * RNGPI * r[1] * scale;
+    const double w = 2.0 * RNGPI * r[3] * scale;
+
+    x[i] = a * cos(v);
+    y[i] = a * sin(v);
+    z[i] = b * cos(w);
+  }
+
+} // RNG::normal3
+
 // __________________________________________________________________________
 // This procedure creates the tables used by RNOR and REXP
 
@@ -91,6 +91,9 @@ inline slong UL32toSL32(ulong x)
   { return (x < 0x80000000ul ? slong(x) : -1 * (0x80000000ul - (x & 0x7ffffffful))); }
 #endif
 
+// Streams of the counter-based random numbers
+enum RNGStream { RNG_NOISE = 1, RNG_DIFFUSION = 2, RNG_ISOCHROMAT = 3, RNG_DIFFUSION_BANK = 4, RNG_DIFFUSION_WALK = 5 };
+
 class RNG
 {
  private:
@@ -164,6 +167,20 @@ class RNG
   void init(ulong z_, ulong w_, ulong jsr_, ulong jcong_ )
     { z = z_; w = w_; jsr = jsr_; jcong = jcong_; }
 
+  // Counter-based random numbers (Philox4x32-10): the output is a
+  // function of (seed, id, stream, n) only, so it does not depend on
+  // which process or thread draws it, nor in which order.
+  static void philox(const ulong ctr[4], const ulong key[2], ulong out[4]);
+  static void counter(ulong seed, ulong id, ulong stream, ulong n, ulong out[4]);
+  // KISS state keyed by (seed, id, stream), e.g. one generator per spin
+  void init(ulong seed, ulong id, ulong stream);
+  // Pair of standard normal variates at counter position n (Box-Muller)
+  static void normal2(ulong seed, ulong id, ulong stream, ulong n, double& x, double& y);
+  // Batch of count triples of standard normal variates at counters (id[i], n[i]),
+  // e.g. the steps of many random walkers; 32 bit uniforms, two Box-Muller pairs per counter
+  static void normal3(ulong seed, ulong stream, int count, const ulong* id, const ulong* n,
+                      double* x, double* y, double* z);
+
   // For a faster but lower quality RNG, uncomment the following
   // line, and comment out the original definition of rand_int above.
   // In practice, the faster RNG will be fine for simulations
@@ -28,11 +28,20 @@
 #include <iomanip>
 #include <typeinfo>
 #include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
 
 #include "Simulator.h"
 #include "BinaryContext.h"
 #include "SequenceTree.h"
 #include "ConcatSequence.h"
+#include "CoilArray.h"
+#include "AnalyticSample.h"
+#include "Checkpoint.h"
+#include "PaketScheduler.h"
+#include "rng.h"
 
 #define DEFAULT_TOLERANCE_SEQ_COMPARE_PPM   1.0
 #define DEFAULT_TOLERANCE_SIG_COMPARE_PPM  10.0
@@ -49,7 +58,11 @@ void usage()
 	cout << "  sanityck <path_to_example_data> 1 : creates tree-dumps and seq-diagrams for some sequences" << endl;
 	cout << "  sanityck <path_to_example_data> 2 : performs simulation on a small sample for all these sequences" << endl;
 	cout << "  sanityck <path_to_example_data> 3 : creates sensitivity maps" << endl;
-	cout << "  sanityck <path_to_example_data> 4 : exports some sequences in pulseq format for scanner execution" << endl
+	cout << "  sanityck <path_to_example_data> 4 : exports some sequences in pulseq format for scanner execution" << endl;
+	cout << "  sanityck <path_to_example_data> 5 : checks the counter-based random numbers against known answers" << endl;
+	cout << "  sanityck <path_to_example_data> 6 : writes and reads restart checkpoints" << endl;
+	cout << "  sanityck <path_to_example_data> 7 : compresses a receive array to virtual coils" << endl;
+	cout << "  sanityck <path_to_example_data> 8 : fits the spin cost model of the paket scheduler" << endl
 		 << endl;
 }
 
@@ -413,6 +426,267 @@ bool CheckOutput(string path, vector<string> seq)
 	return status;
 }
 
+/****************************************************/
+bool CheckRNG()
+{
+
+	bool status = true;
+
+	cout << endl
+		 << "Test Case 5: counter-based random numbers (Philox4x32-10)" << endl;
+	cout << "=======================================================" << endl
+		 << endl;
+
+	// known answers of the Random123 reference implementation
+	const ulong ctr[3][4] = {{0x00000000, 0x00000000, 0x00000000, 0x00000000},
+							 {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+							 {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+	const ulong key[3][2] = {{0x00000000, 0x00000000},
+							 {0xffffffff, 0xffffffff},
+							 {0xa4093822, 0x299f31d0}};
+	const ulong kat[3][4] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+							 {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+							 {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+	for (int i = 0; i < 3; i++)
+	{
+		ulong out[4];
+		RNG::philox(ctr[i], key[i], out);
+		bool ok = (out[0] == kat[i][0] && out[1] == kat[i][1] && out[2] == kat[i][2] && out[3] == kat[i][3]);
+		status = (ok && status);
+		printf("%02d. %08lx %08lx %08lx %08lx (known answer) is %s\n", i + 1, out[0], out[1], out[2], out[3], ok ? "ok" : "NOT ok");
+	}
+
+	// the variates depend on the counter only, not on the order of drawing
+	double x1, y1, x2, y2, x3, y3;
+	RNG::normal2(42, 7, RNG_NOISE, 3, x1, y1);
+	RNG::normal2(42, 7, RNG_NOISE, 4, x3, y3);
+	RNG::normal2(42, 7, RNG_NOISE, 3, x2, y2);
+	bool ok = (x1 == x2 && y1 == y2 && (x1 != x3 || y1 != y3));
+	status = (ok && status);
+	printf("04. normal variates at a counter position (repeatable) is %s\n", ok ? "ok" : "NOT ok");
+
+	return status;
+}
+
+/****************************************************/
+bool CheckCheckpoint(string path, string coils)
+{
+
+	bool status = true;
+
+	cout << endl
+		 << "Test directory: " << path << endl;
+	cout << endl
+		 << "Test Case 6: restart checkpoints (write, read, fall back)" << endl;
+	cout << "=======================================================" << endl
+		 << endl;
+
+	CoilArray ca;
+	ca.Initialize(path + coils);
+	if (ca.Populate() != OK)
+	{
+		cout << "can not read " << coils << " is NOT ok" << endl;
+		return false;
+	}
+	ca.InitializeSignals(100);
+	Checkpoint::Remove();
+
+	// two checkpoints, written to .restart1.dat and .restart0.dat
+	vector<char> state(1000);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (unsigned int c = 0; c < ca.GetSize(); c++)
+		{
+			Repository *r = ca.GetCoil(c)->GetSignal()->Repo();
+			for (long j = 0; j < r->Samples(); j++)
+				r->TP(j) = 0.1 * j;
+			for (long j = 0; j < r->Size(); j++)
+				r->Set(j, pass + 0.5 * c + 1e-3 * j);
+		}
+		for (unsigned int j = 0; j < state.size(); j++)
+			state[j] = (j + pass) % 3;
+		// the destructor waits for the snapshot to be written
+		Checkpoint cp;
+		status = (cp.Save(&ca, state) && status);
+	}
+
+	// the latest checkpoint is read
+	vector<char> loaded(state.size());
+	bool ok = (Checkpoint::Load(&ca, loaded) == 0 && loaded == state);
+	for (unsigned int c = 0; c < ca.GetSize(); c++)
+	{
+		Repository *r = ca.GetCoil(c)->GetSignal()->Repo();
+		for (long j = 0; j < r->Size(); j++)
+			ok = (ok && fabs(r->Value(j) - (1 + 0.5 * c + 1e-3 * j)) < 1e-6);
+		for (long j = 0; j < r->Samples(); j++)
+			ok = (ok && r->TP(j) == 0.1 * j);
+	}
+	status = (ok && status);
+	printf("01. %15s | round trip of the latest checkpoint is %s\n", coils.c_str(), ok ? "ok" : "NOT ok");
+
+	// a checkpoint cut short by a crash is not used, the previous one is
+	ok = false;
+	FILE *f = fopen(".restart0.dat", "rb");
+	if (f != NULL)
+	{
+		fseek(f, 0, SEEK_END);
+		long length = ftell(f);
+		fclose(f);
+		ok = (truncate(".restart0.dat", length / 2) == 0 && Checkpoint::Load(&ca, loaded) == 0);
+	}
+	for (unsigned int j = 0; ok && j < loaded.size(); j++)
+		ok = (loaded[j] == (char)(j % 3));
+	Repository *r = ca.GetCoil(0)->GetSignal()->Repo();
+	ok = (ok && fabs(r->Value(1) - 1e-3) < 1e-6);
+	status = (ok && status);
+	printf("02. %15s | fall back to the previous checkpoint is %s\n", coils.c_str(), ok ? "ok" : "NOT ok");
+
+	Checkpoint::Remove();
+
+	return status;
+}
+
+/****************************************************/
+bool CheckVirtualCoils(string path, string coils, string sample, int nv)
+{
+
+	bool status = true;
+
+	cout << endl
+		 << "Test directory: " << path << endl;
+	cout << endl
+		 << "Test Case 7: compression to virtual coils (SVD)" << endl;
+	cout << "=======================================================" << endl
+		 << endl;
+
+	CoilArray ca;
+	ca.Initialize(path + coils);
+	AnalyticSample sam(path + sample);
+	if (ca.Populate() != OK || sam.GetSize() == 0)
+	{
+		cout << "can not read " << coils << " or " << sample << " is NOT ok" << endl;
+		return false;
+	}
+
+	// sensitivities of the physical coils at the voxels of the sample
+	int nc = ca.GetSize();
+	size_t nvox = sam.GetSize() / sam.GetIsochromats();
+	vector<std::complex<double> > sens(nvox * nc);
+	vector<double> energy(nc, 0.0);
+	for (size_t n = 0; n < nvox; n++)
+	{
+		double position[3], mag, pha;
+		sam.GetVoxelPosition(n, position);
+		for (int c = 0; c < nc; c++)
+		{
+			ca.GetCoil(c)->GetB1(position, mag, pha);
+			sens[n * nc + c] = std::polar(mag, pha);
+			energy[c] += mag * mag;
+		}
+	}
+
+	ca.SetVirtualCoils(nv);
+	ca.Compress(&sam);
+	const vector<std::complex<double> > &A = ca.GetCompression();
+	if ((int)A.size() != nv * nc || (int)ca.GetSize() != nv)
+	{
+		cout << "no compression matrix is NOT ok" << endl;
+		return false;
+	}
+
+	// the compression matrix has orthonormal rows
+	double e = 0.0;
+	for (int k = 0; k < nv; k++)
+		for (int l = 0; l < nv; l++)
+		{
+			std::complex<double> s = 0.0;
+			for (int c = 0; c < nc; c++)
+				s += A[k * nc + c] * conj(A[l * nc + c]);
+			e = max(e, abs(s - (k == l ? 1.0 : 0.0)));
+		}
+	bool ok = (e < 1e-9);
+	status = (ok && status);
+	printf("01. %15s | orthonormal compression (e=%7.1e) is %s\n", coils.c_str(), e, ok ? "ok" : "NOT ok");
+
+	// principal components: decreasing energy, the first one beats every physical coil
+	vector<double> venergy(nv, 0.0);
+	for (size_t n = 0; n < nvox; n++)
+		for (int k = 0; k < nv; k++)
+		{
+			std::complex<double> v = 0.0;
+			for (int c = 0; c < nc; c++)
+				v += A[k * nc + c] * sens[n * nc + c];
+			venergy[k] += norm(v);
+		}
+	ok = (venergy[0] >= *max_element(energy.begin(), energy.end()) * (1 - 1e-9));
+	for (int k = 1; k < nv; k++)
+		ok = (ok && venergy[k] <= venergy[k - 1] * (1 + 1e-9));
+	status = (ok && status);
+	printf("02. %15s | principal components (%d of %d coils) is %s\n", coils.c_str(), nv, nc, ok ? "ok" : "NOT ok");
+
+	return status;
+}
+
+/****************************************************/
+bool CheckScheduler()
+{
+
+	bool status = true;
+
+	cout << endl
+		 << "Test Case 8: cost model of the paket scheduler" << endl;
+	cout << "=======================================================" << endl
+		 << endl;
+
+	// two slaves, the second one twice as fast; known linear cost of a spin;
+	// the spins of a paket are of one tissue, so the cost of the pakets differs a lot
+	PaketScheduler ps;
+	ps.Init(3, 2, 30.0);
+	const double w[NO_COST_FEATURES] = {1e-3, 2e-4, 5e-3, 1e-3};
+	const double speed[3] = {0.0, 1.0, 2.0};
+
+	RNG rng(4711);
+	for (int k = 0; k < 400; k++)
+	{
+		int id = 1 + k % 2;
+		int n = 100;
+		double phi[NO_COST_FEATURES] = {0.0, 0.0, 0.0, 0.0};
+		double tissue[3] = {100.0 * rng.uniform(0, 1), 0.1 * rng.uniform(0, 1), rng.uniform(0, 1)};
+		for (int j = 0; j < n; j++)
+		{
+			double val[NO_SPIN_PROPERTIES] = {0.0};
+			val[DB] = tissue[0] * rng.uniform(0.5, 1.5);
+			val[R2] = tissue[1] * rng.uniform(0.5, 1.5);
+			val[M0] = tissue[2] * rng.uniform(0.5, 1.5);
+			PaketScheduler::AddFeatures(val, 1, phi);
+		}
+		double t = 0.0;
+		for (int i = 0; i < NO_COST_FEATURES; i++)
+			t += w[i] * phi[i];
+		ps.Sent(id, phi, n);
+		ps.Requested(id, t / speed[id], 0);
+	}
+
+	// relative throughput of the slaves
+	double r = ps.Speed(2) / ps.Speed(1);
+	bool ok = (fabs(r - 2.0) < 0.1 && fabs(ps.Speed(1) + ps.Speed(2) - 2.0) < 1e-9);
+	status = (ok && status);
+	printf("01. relative speed of the slaves (%5.3f) is %s\n", r, ok ? "ok" : "NOT ok");
+
+	// predicted time of a spin on an average slave (1.5 times the speed of the first one)
+	const double x[NO_COST_FEATURES] = {1.0, 50.0, 0.05, 0.5};
+	double t = 0.0;
+	for (int i = 0; i < NO_COST_FEATURES; i++)
+		t += w[i] * x[i] / 1.5;
+	double e = fabs(ps.SpinCost(x) - t) / t;
+	ok = (e < 0.05);
+	status = (ok && status);
+	printf("02. predicted spin cost (e=%5.2f%%) is %s\n", 100 * e, ok ? "ok" : "NOT ok");
+
+	return status;
+}
+
 /****************************************************/
 int main(int argc, char *argv[])
 {
@@ -483,6 +757,18 @@ int main(int argc, char *argv[])
 	case (4):
 		status = CheckOutput(path, outseq);
 		break; // test sequence output for execution
+	case (5):
+		status = CheckRNG();
+		break; // test counter-based random numbers
+	case (6):
+		status = CheckCheckpoint(path, coils[0]);
+		break; // test restart checkpoints
+	case (7):
+		status = CheckVirtualCoils(path, coils[0], "analytic_phantom.xml", 4);
+		break; // test compression of the receive array
+	case (8):
+		status = CheckScheduler();
+		break; // test paket scheduler
 	default:
 		cout << "\nsanityck: unknown input\n\n";
 		break;